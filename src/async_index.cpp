@@ -0,0 +1,240 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "async_index.h"
+#include <climits>
+#include <coroutine>
+#include <exception>
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+
+namespace badgerdb
+{
+
+/**
+ * The coroutine type of a probe. It starts suspended, so that the scheduler decides when it runs,
+ * and stays suspended at the end until the scheduler destroys it.
+ */
+struct IndexProbe {
+	struct promise_type {
+		std::exception_ptr error;
+
+		IndexProbe get_return_object()
+		{
+			return IndexProbe{ std::coroutine_handle<promise_type>::from_promise(*this) };
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { error = std::current_exception(); }
+	};
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+typedef std::coroutine_handle<IndexProbe::promise_type> ProbeHandle;
+
+/**
+ * Awaited before every page read of a probe. A resident page is read right away; otherwise the
+ * operating system is asked to fetch it and the probe yields to the others.
+ */
+struct AsyncIndexScheduler::PageRead {
+	AsyncIndexScheduler *scheduler;
+	PageId pageNum;
+
+	bool await_ready()
+	{
+		BTreeIndex *index = scheduler->index;
+		return index->bufMgr->isResident(index->file, pageNum);
+	}
+
+	void await_suspend(std::coroutine_handle<>)
+	{
+		scheduler->index->file->prefetchPages(pageNum, 1);
+		scheduler->suspensions++;
+	}
+
+	void await_resume() {}
+};
+
+// -----------------------------------------------------------------------------
+// AsyncIndexScheduler::AsyncIndexScheduler -- Constructor
+// -----------------------------------------------------------------------------
+
+AsyncIndexScheduler::AsyncIndexScheduler(BTreeIndex *index, const int maxInFlight)
+{
+	AsyncIndexScheduler::index = index;
+	AsyncIndexScheduler::maxInFlight = maxInFlight > 0 ? maxInFlight : 1;
+	suspensions = 0;
+}
+
+// -----------------------------------------------------------------------------
+// AsyncIndexScheduler::~AsyncIndexScheduler -- destructor
+// -----------------------------------------------------------------------------
+
+AsyncIndexScheduler::~AsyncIndexScheduler()
+{
+	dropRunning();
+}
+
+void AsyncIndexScheduler::dropRunning()
+{
+	for(std::size_t i = 0; i < running.size(); i++)
+	{
+		ProbeHandle::from_address(running[i]).destroy();
+	}
+	running.clear();
+}
+
+// -----------------------------------------------------------------------------
+// AsyncIndexScheduler::lookup
+// -----------------------------------------------------------------------------
+
+void AsyncIndexScheduler::lookup(const void* key, std::vector<RecordId> & outRids)
+{
+	scan(key, GTE, key, LTE, outRids);
+}
+
+// -----------------------------------------------------------------------------
+// AsyncIndexScheduler::scan
+// -----------------------------------------------------------------------------
+
+void AsyncIndexScheduler::scan(const void* lowValParm, const Operator lowOpParm,
+		const void* highValParm, const Operator highOpParm, std::vector<RecordId> & outRids)
+{
+	if(lowOpParm != Operator::GT && lowOpParm != Operator::GTE) throw BadOpcodesException();
+	if(highOpParm != Operator::LT && highOpParm != Operator::LTE) throw BadOpcodesException();
+
+	int low = *reinterpret_cast<const int*>(lowValParm);
+	int high = *reinterpret_cast<const int*>(highValParm);
+	if(low > high) throw BadScanrangeException();
+	outRids.clear();
+
+	// an open bound that excludes every int leaves nothing to probe
+	if(lowOpParm == Operator::GT) {
+		if(low == INT_MAX) return;
+		low++;
+	}
+	if(highOpParm == Operator::LT) {
+		if(high == INT_MIN) return;
+		high--;
+	}
+	if(low > high) return;
+
+	PendingProbe probe = { low, high, &outRids };
+	pending.push_back(probe);
+}
+
+// -----------------------------------------------------------------------------
+// AsyncIndexScheduler::run
+// -----------------------------------------------------------------------------
+
+void AsyncIndexScheduler::run()
+{
+	// the leaves have to hold every entry
+	if(index->bufferedNodes) {
+		index->flushMessages();
+	}
+
+	while(!pending.empty() || !running.empty())
+	{
+		while(static_cast<int>(running.size()) < maxInFlight && !pending.empty())
+		{
+			const PendingProbe & next = pending.front();
+			running.push_back(probe(this, next.low, next.high, next.outRids).handle.address());
+			pending.pop_front();
+		}
+
+		ProbeHandle handle = ProbeHandle::from_address(running.front());
+		running.pop_front();
+		handle.resume();
+		if(!handle.done()) {
+			running.push_back(handle.address());
+			continue;
+		}
+
+		std::exception_ptr error = handle.promise().error;
+		handle.destroy();
+		if(error) {
+			dropRunning();
+			pending.clear();
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// AsyncIndexScheduler::probe
+// -----------------------------------------------------------------------------
+
+IndexProbe AsyncIndexScheduler::probe(AsyncIndexScheduler *scheduler, int low, int high, std::vector<RecordId> *outRids)
+{
+	BTreeIndex *index = scheduler->index;
+	BufMgr *bufMgr = index->bufMgr;
+	BlobFile *file = index->file;
+
+	// the same descent as a scan, but a page is only read once it is likely in memory
+	PageId pageNum = index->rootPageNum;
+	bool isLeaf = index->rootPageNum == index->initialRootPageNum;
+	Page *page;
+	co_await PageRead{ scheduler, pageNum };
+	bufMgr->readPage(file, pageNum, page);
+
+	while(!isLeaf)
+	{
+		// a probe that fails while a page is pinned unpins it before the error reaches the scheduler
+		PageId childPageNum;
+		try {
+			NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+			childPageNum = index->findLeastPageId(node, low, GTE);
+			isLeaf = node->level == 1;
+		}
+		catch(...) {
+			bufMgr->unPinPage(file, pageNum, false);
+			throw;
+		}
+
+		// nothing stays pinned while the probe is suspended
+		bufMgr->unPinPage(file, pageNum, false);
+		pageNum = childPageNum;
+		co_await PageRead{ scheduler, pageNum };
+		bufMgr->readPage(file, pageNum, page);
+	}
+
+	// the first leaf is searched for the low bound, the ones after it are read from their first entry
+	int keyIndex = -1;
+	while(true)
+	{
+		PageId nextPage;
+		try {
+			LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+			int keyCount = index->getLeafOccupancy(leaf);
+			if(keyIndex < 0) {
+				keyIndex = index->findKeyIndex(leaf->keyArray, keyCount, low, true);
+			}
+			for(; keyIndex < keyCount && leaf->keyArray[keyIndex] <= high; keyIndex++)
+			{
+				outRids->push_back(leaf->ridArray[keyIndex]);
+			}
+			nextPage = keyIndex < keyCount ? Page::INVALID_NUMBER : leaf->rightSibPageNo;
+		}
+		catch(...) {
+			bufMgr->unPinPage(file, pageNum, false);
+			throw;
+		}
+
+		bufMgr->unPinPage(file, pageNum, false);
+		if(nextPage == Page::INVALID_NUMBER) co_return;
+
+		pageNum = nextPage;
+		co_await PageRead{ scheduler, pageNum };
+		bufMgr->readPage(file, pageNum, page);
+		keyIndex = 0;
+	}
+}
+
+}
@@ -0,0 +1,143 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+
+#include "types.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Coroutine running one lookup or scan for AsyncIndexScheduler. Defined in async_index.cpp,
+ * the only translation unit built as C++20.
+ */
+struct IndexProbe;
+
+/**
+ * @brief AsyncIndexScheduler class. It runs many lookups and scans of a B+ Tree index on one thread,
+ * interleaved. Every lookup or scan is a coroutine that descends the tree like a scan does, but
+ * suspends before reading a page that is not in the buffer pool, after asking the operating system
+ * to start reading it. Other probes run meanwhile, so by the time the probe is resumed its page is
+ * usually in the page cache and the reads of many probes overlap instead of following one another.
+ * A probe keeps no page pinned while it is suspended.
+ *
+ * No other method of the index may be called while run() executes.
+*/
+class AsyncIndexScheduler {
+
+ public:
+
+  /**
+   * AsyncIndexScheduler Constructor.
+   *
+   * @param index          Index the probes run on.
+   * @param maxInFlight    Maximum number of probes started but not finished at any time.
+   */
+	AsyncIndexScheduler(BTreeIndex *index, const int maxInFlight = 16);
+
+
+  /**
+   * AsyncIndexScheduler Destructor. Probes that haven't finished are dropped.
+	 * */
+	~AsyncIndexScheduler();
+
+
+  /**
+	 * Queue a lookup of every entry with a key. It runs during the next run().
+   * @param key			Key to look up, pointer to integer / double / char string
+   * @param outRids	Record ids of the entries with the key, in key order, returned in this. Must stay alive until run() returns.
+	**/
+	void lookup(const void* key, std::vector<RecordId> & outRids);
+
+
+  /**
+	 * Queue a scan of a range, with the same parameters as BTreeIndex::startScan(). It runs during the next run().
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @param outRids	Record ids of the entries in the range, in key order, returned in this. Must stay alive until run() returns.
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	**/
+	void scan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			std::vector<RecordId> & outRids);
+
+
+  /**
+	 * Run every queued probe to completion, resuming the probes in flight in turn. Buffered messages of the index are flushed first.
+	**/
+	void run();
+
+
+  /**
+	 * Returns the number of times a probe suspended on a page that wasn't in the buffer pool.
+	**/
+	int getSuspensions() const
+	{
+		return suspensions;
+	}
+
+ private:
+
+  /**
+   * A queued probe: the keys of the range, both inclusive, and where its record ids go.
+   */
+	struct PendingProbe {
+		int low;
+		int high;
+		std::vector<RecordId> *outRids;
+	};
+
+  /**
+   * Awaitable of a page read, defined in async_index.cpp. Suspends the probe if the page isn't in the buffer pool.
+   */
+	struct PageRead;
+
+  /**
+   * Index the probes run on.
+   */
+	BTreeIndex	*index;
+
+  /**
+   * Maximum number of probes in flight.
+   */
+	int			maxInFlight;
+
+  /**
+   * Probes queued but not started.
+   */
+	std::deque<PendingProbe>	pending;
+
+  /**
+   * Coroutine handles, as addresses, of the probes in flight, in the order they are resumed.
+   */
+	std::deque<void*>	running;
+
+  /**
+   * Number of suspensions on pages missing from the buffer pool.
+   */
+	int			suspensions;
+
+  /**
+   * The coroutine of a probe: appends the record ids of the entries with keys in [low, high] to outRids.
+   */
+	static IndexProbe probe(AsyncIndexScheduler *scheduler, int low, int high, std::vector<RecordId> *outRids);
+
+  /**
+   * Destroys the coroutines of the probes in flight.
+   */
+	void dropRunning();
+};
+
+}
@@ -0,0 +1,172 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bitmap_scan.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/badgerdb_exception.h"
+
+namespace badgerdb {
+
+BitmapHeapScan::BitmapHeapScan(PageFile *relationFile, BufMgr *bufferMgr, BTreeIndex *scanIndex,
+                               const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+                               const std::size_t maxRids)
+{
+  file = relationFile;
+  bufMgr = bufferMgr;
+  index = scanIndex;
+  chunkSize = maxRids;
+  curPage = NULL;
+  pagesRead = 0;
+
+  // an empty range is just a scan without records
+  indexScanning = true;
+  try
+  {
+    index->startScan(lowVal, lowOp, highVal, highOp);
+  }
+  catch(const NoSuchKeyFoundException &e)
+  {
+    indexScanning = false;
+  }
+
+  collectChunk();
+}
+
+BitmapHeapScan::BitmapHeapScan(PageFile *relationFile, BufMgr *bufferMgr, const RidBitmap &rids)
+{
+  file = relationFile;
+  bufMgr = bufferMgr;
+  index = NULL;
+  chunkSize = 0;
+  curPage = NULL;
+  pagesRead = 0;
+
+  // the whole set is a single chunk
+  indexScanning = false;
+  rids.getSlotBitmaps(pageBitmaps);
+  currentBitmap = pageBitmaps.begin();
+  curRid.page_number = Page::INVALID_NUMBER;
+  curRid.slot_number = 0;
+}
+
+BitmapHeapScan::~BitmapHeapScan()
+{
+  try
+  {
+    if (curPage != NULL)
+    {
+      bufMgr->unPinPage(file, currentBitmap->first, false);
+      curPage = NULL;
+    }
+    if (indexScanning)
+    {
+      index->endScan();
+    }
+  }
+  catch(const BadgerDbException &e)
+  {
+    // the destructor must not throw
+  }
+}
+
+bool BitmapHeapScan::collectChunk()
+{
+  pageBitmaps.clear();
+
+  std::size_t collected = 0;
+  while (indexScanning && (chunkSize == 0 || collected < chunkSize))
+  {
+    RecordId rid;
+    try
+    {
+      index->scanNext(rid);
+    }
+    catch(const IndexScanCompletedException &e)
+    {
+      index->endScan();
+      indexScanning = false;
+      break;
+    }
+
+    std::vector<std::uint64_t> &bitmap = pageBitmaps[rid.page_number];
+    std::size_t word = rid.slot_number / 64;
+    if (bitmap.size() <= word)
+    {
+      bitmap.resize(word + 1, 0);
+    }
+    bitmap[word] |= std::uint64_t(1) << (rid.slot_number % 64);
+    collected++;
+  }
+
+  currentBitmap = pageBitmaps.begin();
+  curRid.page_number = Page::INVALID_NUMBER;
+  curRid.slot_number = 0;
+  return !pageBitmaps.empty();
+}
+
+void BitmapHeapScan::scanNext(RecordId& outRid)
+{
+  while (true)
+  {
+    if (currentBitmap == pageBitmaps.end())
+    {
+      if (!collectChunk())
+      {
+        throw EndOfFileException();
+      }
+    }
+
+    const std::vector<std::uint64_t> &bitmap = currentBitmap->second;
+    bool samePage = curRid.page_number == currentBitmap->first;
+    std::size_t slot = samePage ? curRid.slot_number + 1 : 0;
+
+    // next set bit of the page's bitmap
+    for (std::size_t word = slot / 64; word < bitmap.size(); word++)
+    {
+      std::uint64_t bits = bitmap[word];
+      if (word == slot / 64)
+      {
+        bits &= ~std::uint64_t(0) << (slot % 64);
+      }
+      if (bits == 0)
+        continue;
+
+      // each page is read once, when its first record is reached
+      if (!samePage)
+      {
+        bufMgr->readPage(file, currentBitmap->first, curPage);
+        pagesRead++;
+      }
+
+      int bit = 0;
+      while (!(bits & (std::uint64_t(1) << bit)))
+      {
+        bit++;
+      }
+      curRid.page_number = currentBitmap->first;
+      curRid.slot_number = static_cast<SlotId>(word * 64 + bit);
+      outRid = curRid;
+      return;
+    }
+
+    if (samePage)
+    {
+      bufMgr->unPinPage(file, currentBitmap->first, false);
+      curPage = NULL;
+    }
+    ++currentBitmap;
+  }
+}
+
+std::string BitmapHeapScan::getRecord()
+{
+  return curPage->getRecord(curRid);
+}
+
+}
@@ -0,0 +1,145 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+#include "rid_bitmap.h"
+
+namespace badgerdb {
+
+/**
+ * @brief This class fetches the records of a relation whose keys fall in a range of an index.
+ *
+ * An index scan returns record ids in key order, which visits the pages of the relation in no
+ * particular order. This scan instead collects the record ids into a bitmap of slots for every
+ * page, and then reads each page once, in page order, returning its records in slot order.
+ * When the number of record ids held is limited, the range is fetched in chunks of that many
+ * record ids, each one read in page order.
+ */
+class BitmapHeapScan
+{
+ public:
+
+  /**
+   * Starts a scan of the records in a range of an index. The index scan is kept open until
+   * the last chunk has been collected, so no other scan of the index may run meanwhile.
+   *
+   * @param file      Relation file the index was built on, shared with the caller.
+   * @param bufMgr    Buffer Manager instance used to read pages into buffer pool.
+   * @param index     Index to scan.
+   * @param lowVal    Low value of range, pointer to integer / double / char string
+   * @param lowOp     Low operator (GT/GTE)
+   * @param highVal   High value of range, pointer to integer / double / char string
+   * @param highOp    High operator (LT/LTE)
+   * @param chunkSize Maximum number of record ids collected before their pages are read, 0 for no limit.
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+   */
+  BitmapHeapScan(PageFile *file, BufMgr *bufMgr, BTreeIndex *index,
+                 const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+                 const std::size_t chunkSize = 0);
+
+  /**
+   * Starts a scan of the records in a set of record ids, e.g. the intersection of the ranges of two indexes.
+   *
+   * @param file      Relation file the record ids point into, shared with the caller.
+   * @param bufMgr    Buffer Manager instance used to read pages into buffer pool.
+   * @param rids      Record ids of the records to return.
+   */
+  BitmapHeapScan(PageFile *file, BufMgr *bufMgr, const RidBitmap &rids);
+
+  /**
+   * Ends the index scan if it is still open and unpins the current page.
+   */
+  ~BitmapHeapScan();
+
+  /**
+   * Moves to the next record in the range. Records come in page order within a chunk.
+   *
+   * @param outRid  RecordId of the next record returned in this
+   * @throws  EndOfFileException  If every record in the range has been returned.
+   */
+  void scanNext(RecordId& outRid);
+
+  /**
+   * Returns the current record. Its page stays pinned until the scan moves past it.
+   */
+  std::string getRecord();
+
+  /**
+   * Returns the number of pages of the relation read so far.
+   */
+  int getPagesRead() const { return pagesRead; }
+
+ private:
+
+  /**
+   * Relation file being read.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read/write pages into/from buffer pool.
+   */
+  BufMgr        *bufMgr;
+
+  /**
+   * Index the record ids come from, NULL if they come from a RidBitmap.
+   */
+  BTreeIndex    *index;
+
+  /**
+   * True while the index scan has more record ids.
+   */
+  bool          indexScanning;
+
+  /**
+   * Maximum number of record ids in a chunk, 0 for no limit.
+   */
+  std::size_t   chunkSize;
+
+  /**
+   * Slots of the current chunk, a bitmap for every page holding one of them, in page order.
+   */
+  std::map< PageId, std::vector<std::uint64_t> > pageBitmaps;
+
+  /**
+   * Page of the chunk being read.
+   */
+  std::map< PageId, std::vector<std::uint64_t> >::iterator currentBitmap;
+
+  /**
+   * Current page being read, NULL if none is pinned.
+   */
+  Page          *curPage;
+
+  /**
+   * Current record.
+   */
+  RecordId      curRid;
+
+  /**
+   * Number of pages of the relation read so far.
+   */
+  int           pagesRead;
+
+  /**
+   * Collects the next chunk of record ids from the index scan. Returns false if there are none left.
+   */
+  bool collectChunk();
+};
+
+}
@@ -6,15 +6,29 @@
  */
 
 #include "btree.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <limits>
+#include <fstream>
+#include <thread>
+#include <exception>
+#include <sys/stat.h>
 #include "filescan.h"
+#include "index_snapshot.h"
+#include "range_filter.h"
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/bad_scan_param_exception.h"
 #include "exceptions/no_such_key_found_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
+#include "exceptions/file_write_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/badgerdb_exception.h"
 
 
 //#define DEBUG
@@ -23,94 +37,350 @@ namespace badgerdb
 {
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::BTreeIndex -- Constructor
+// readRelationMarker
 // -----------------------------------------------------------------------------
 
+bool readRelationMarker(const std::string & relationName, PageId & pageCount, std::int64_t & modTime)
+{
+	struct stat relationStat;
+	if(stat(relationName.c_str(), &relationStat) != 0) return false;
+
+	pageCount = static_cast<PageId>((relationStat.st_size - sizeof(FileHeader)) / Page::SIZE);
+	modTime = static_cast<std::int64_t>(relationStat.st_mtim.tv_sec) * 1000000000 + relationStat.st_mtim.tv_nsec;
+	return true;
+}
+
+/**
+ * Scan kernel: returns the index of the first of the keys from first to count that is past the range. The keys are
+ * sorted and the key at first satisfies the low bound, so that is first plus the number of keys in the range, which
+ * countKeysBetween() counts with a vector compare. The operators are fixed at compile time, so the bounds are made
+ * inclusive without testing them.
+ */
+template <Operator LowOp, Operator HighOp>
+static int rangeEnd(const int *keyArray, int first, int count, int lowVal, int highVal)
+{
+	if((LowOp == Operator::GT && lowVal == INT_MAX) || (HighOp == Operator::LT && highVal == INT_MIN)) return first;
+	int low = LowOp == Operator::GT ? lowVal + 1 : lowVal;
+	int high = HighOp == Operator::LT ? highVal - 1 : highVal;
+	return first + countKeysBetween(keyArray + first, count - first, low, high);
+}
+
+/**
+ * Returns the instance of rangeEnd() for the operators of a range.
+ */
+static int (*rangeEndFor(Operator lowOp, Operator highOp))(const int *, int, int, int, int)
+{
+	if(lowOp == Operator::GT) {
+		return highOp == Operator::LT ? &rangeEnd<Operator::GT, Operator::LT> : &rangeEnd<Operator::GT, Operator::LTE>;
+	}
+	return highOp == Operator::LT ? &rangeEnd<Operator::GTE, Operator::LT> : &rangeEnd<Operator::GTE, Operator::LTE>;
+}
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::BTreeIndex -- Constructor
+// -----------------------------------------------------------------------------
 
 BTreeIndex::BTreeIndex(const std::string & relationName,
 		std::string & outIndexName,
 		BufMgr *bufMgrIn,
 		const int attrByteOffset,
-		const Datatype attrType)
+		const Datatype attrType,
+		const bool online,
+		const bool bloomFilter,
+		const bool bufferedNodes,
+		const IndexPredicate *predicate)
 {
 	bufMgr = bufMgrIn;
+	BTreeIndex::relationName = relationName;
 	attributeType = attrType; // should just be INTEGER
 	BTreeIndex::attrByteOffset = attrByteOffset;
+	leafOccupancy = INTARRAYLEAFSIZE;
+	BTreeIndex::bufferedNodes = bufferedNodes;
+	nodeOccupancy = bufferedNodes ? BUFFEREDNONLEAFSIZE : INTARRAYNONLEAFSIZE;
+	height = 1;
+
+	partial = predicate != NULL;
+	memset(&this->predicate, 0, sizeof(IndexPredicate));
+	if(partial) {
+		if(predicate->attrType != INTEGER && predicate->attrType != DOUBLE)
+			throw BadIndexInfoException("predicate attribute must be INTEGER or DOUBLE");
+		BTreeIndex::predicate = *predicate;
+	}
+
+	scanExecuting = false;
+	nextEntry = -1;
+	leafEntryCount = 0;
+	leafRangeEnd = 0;
+	rangeEndKernel = &rangeEnd<Operator::GTE, Operator::LTE>;
+	scanFiltered = false;
+	windowSelected = false;
+	windowEnd = 0;
+	nextRun = 0;
+	runEnd = 0;
+	entryReturned = false;
+	scanLimit = 0;
+	scanReturned = 0;
+	currentPageNum = Page::INVALID_NUMBER;
+	currentPageData = NULL;
+	currentRange = 0;
+	nextInsert = 0;
+
+	searchStrategy = INTERPOLATION_SEARCH;
+	windowProbes = 0;
+	windowHits = 0;
+	searchesSinceSample = 0;
+
+	memset(&statsInfo, 0, sizeof(statsInfo));
+	statsPageNum = Page::INVALID_NUMBER;
+	buildingIndex = false;
+	buildScan = NULL;
+
+	useBloomFilter = bloomFilter;
+	bloomPageNum = Page::INVALID_NUMBER;
+	bloomPageCount = 0;
+	bloomDirty = false;
+	freePagesDirty = false;
+	bloomWindowLookups = 0;
+	bloomWindowFalsePositives = 0;
+
+	modelEntries = 0;
+	modelValid = false;
+	modelPageNum = Page::INVALID_NUMBER;
+	modelPageCount = 0;
 
 	std::ostringstream idxStr;
 	idxStr << relationName << '.' << attrByteOffset;
+	if(partial) {
+		static const char *opNames[] = { "lt", "lte", "gte", "gt" };
+		idxStr << ".where" << predicate->attrByteOffset << opNames[predicate->op] << predicate->value;
+	}
 	std::string indexName = idxStr.str(); // indexName is the name of the index file
 	outIndexName = indexName;
 
-	// if indexName exists, then the file is opened. Else, a new index file is created.
-	try {
-		BlobFile bf = BlobFile::open(indexName);
-		file = &bf;
-		// index file already exists:
-		
-		// read meta info (btree.h:108)
-		Page *metaPage;
-		bufMgr->readPage(file, 0, metaPage);
-		IndexMetaInfo metaInfo = *reinterpret_cast<IndexMetaInfo*>(metaPage);
-		rootPageNum = metaInfo.rootPageNo;
+	// if indexName exists and is in sync with the relation, then the file is opened.
+	// Else, a new index file is created and built from the relation.
+	if(openIndexFile(indexName, relationName)) {
+		std::cout << "Index file " << indexName << " opened." << std::endl;
+		if(useBloomFilter && bloomBlocks.empty()) {
+			rebuildBloomFilter();
+		}
+		return;
+	}
+
+	createIndexFile(indexName, relationName);
+	if(online) {
+		startBuild(relationName);
+		return;
+	}
+	buildIndex(relationName);
+}
 
-		// TODO : this shouldn't be necessary after calling open:
-		// file = &BlobFile::create(indexName); 
+bool BTreeIndex::openIndexFile(const std::string & indexName, const std::string & relationName)
+{
+	try {
+		file = new BlobFile(indexName, false);
 	}
 	catch(FileNotFoundException const&) {
-		// index file doesn't already exist:
+		// index file doesn't already exist
+		return false;
+	}
+
+	// read meta info (btree.h:108)
+	headerPageNum = file->getFirstPageNo();
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	IndexMetaInfo metaInfo = *reinterpret_cast<IndexMetaInfo*>(metaPage);
+	bufMgr->unPinPage(file, headerPageNum, false);
+
+	// the file has to describe the index asked for
+	std::string reason;
+	if(strncmp(metaInfo.relationName, relationName.c_str(), sizeof(metaInfo.relationName) - 1) != 0)
+		reason = "relation name does not match";
+	else if(metaInfo.attrByteOffset != attrByteOffset)
+		reason = "attribute byte offset does not match";
+	else if(metaInfo.attrType != attributeType)
+		reason = "attribute type does not match";
+	else if((metaInfo.partial != 0) != partial || (partial && (metaInfo.predicate.attrByteOffset != predicate.attrByteOffset ||
+			metaInfo.predicate.attrType != predicate.attrType || metaInfo.predicate.op != predicate.op ||
+			metaInfo.predicate.value != predicate.value)))
+		reason = "predicate does not match";
+
+	if(!reason.empty()) {
+		bufMgr->flushFile(file);
+		delete file;
+		throw BadIndexInfoException(reason);
+	}
+
+	// rebuild if the relation changed since the index was last in sync with it
+	PageId pageCount;
+	std::int64_t modTime;
+	if(!readRelationMarker(relationName, pageCount, modTime) ||
+			pageCount != metaInfo.relationPageCount || modTime != metaInfo.relationModTime) {
+		bufMgr->flushFile(file);
+		delete file;
+		File::remove(indexName);
+		return false;
+	}
+
+	// pages left in the extents go on being handed out, next to the pages allocated before
+	for(int i = 0; i < BlobFile::EXTENT_COUNT; i++) {
+		file->restoreExtent(i, metaInfo.extents[i]);
+	}
+
+	readFreePages(metaInfo.freePageNo);
 
-		file = &BlobFile::create(indexName);
-		
-		// initialize meta info page
-		IndexMetaInfo newInfo;
-		strcpy(newInfo.relationName, relationName.c_str());
-		newInfo.attrByteOffset = attrByteOffset;
-		newInfo.attrType = attrType;
-		newInfo.rootPageNo = 1;
-		rootPageNum = 1;
+	rootPageNum = metaInfo.rootPageNo;
+	height = metaInfo.height;
+	bufferedNodes = metaInfo.bufferedNodes != 0;
+	nodeOccupancy = bufferedNodes ? BUFFEREDNONLEAFSIZE : INTARRAYNONLEAFSIZE;
+	statsPageNum = metaInfo.statsPageNo;
+
+	if(statsPageNum != Page::INVALID_NUMBER) {
+		Page *statsPage;
+		bufMgr->readPage(file, statsPageNum, statsPage);
+		statsInfo = *reinterpret_cast<IndexStatsInfo*>(statsPage);
+		bufMgr->unPinPage(file, statsPageNum, false);
+	}
 
-		// read meta info page to file
-		Page* metaPage = reinterpret_cast<Page*>(&newInfo);
-		file->writePage(0, *metaPage);
+	bloomPageNum = metaInfo.bloomPageNo;
+	bloomPageCount = metaInfo.bloomPageCount;
+	bloomBlocks.resize(metaInfo.bloomBlockCount);
+	for(int i = 0; i < bloomPageCount; i++) {
+		int first = i * BLOOMBLOCKSPERPAGE;
+		int count = std::min(BLOOMBLOCKSPERPAGE, metaInfo.bloomBlockCount - first);
+		if(count <= 0) break;
+
+		Page *bloomPage;
+		bufMgr->readPage(file, bloomPageNum + i, bloomPage);
+		memcpy(&bloomBlocks[first], reinterpret_cast<BloomBlock*>(bloomPage), count * sizeof(BloomBlock));
+		bufMgr->unPinPage(file, bloomPageNum + i, false);
+	}
 
-		// initialize root node
-		NonLeafNodeInt* rootNode;
-		rootNode->level = 1;
-		
-		Page* rootPage;
-		bufMgr->allocPage(file, rootPageNum, rootPage);
-		*rootPage = *reinterpret_cast<Page*>(rootNode);
+	modelPageNum = metaInfo.modelPageNo;
+	modelPageCount = metaInfo.modelPageCount;
+	if(metaInfo.modelValid && metaInfo.modelSegmentCount > 0 && metaInfo.modelLeafCount > 0) {
+		std::vector<char> bytes(static_cast<std::size_t>(modelPageCount) * Page::SIZE);
+		for(int i = 0; i < modelPageCount; i++) {
+			Page *modelPage;
+			bufMgr->readPage(file, modelPageNum + i, modelPage);
+			memcpy(&bytes[i * Page::SIZE], reinterpret_cast<char*>(modelPage), Page::SIZE);
+			bufMgr->unPinPage(file, modelPageNum + i, false);
+		}
 
-		// = (Page*) &rootNode;
-		// file->writePage(1, *rootPage);
+		const char *next = bytes.data();
+		modelSegments.resize(metaInfo.modelSegmentCount);
+		memcpy(modelSegments.data(), next, modelSegments.size() * sizeof(LearnedSegment));
+		next += modelSegments.size() * sizeof(LearnedSegment);
+		modelLeafPages.resize(metaInfo.modelLeafCount);
+		memcpy(modelLeafPages.data(), next, modelLeafPages.size() * sizeof(PageId));
+		next += modelLeafPages.size() * sizeof(PageId);
+		modelLeafStarts.resize(metaInfo.modelLeafCount);
+		memcpy(modelLeafStarts.data(), next, modelLeafStarts.size() * sizeof(int));
+		modelEntries = metaInfo.modelEntryCount;
+		modelValid = true;
 	}
 
+	// the first root is always allocated right after the meta page
+	initialRootPageNum = headerPageNum + 1;
+	return true;
+}
+
+void BTreeIndex::createIndexFile(const std::string & indexName, const std::string & relationName)
+{
+	file = new BlobFile(indexName, true);
+
+	// the meta page comes first, followed by the root which starts out as an empty leaf
+	Page *metaPage;
+	bufMgr->allocPage(file, headerPageNum, metaPage);
+	Page *rootPage;
+	bufMgr->allocPage(file, rootPageNum, rootPage);
+	memset(reinterpret_cast<LeafNodeInt*>(rootPage), 0, Page::SIZE);
+	initialRootPageNum = rootPageNum;
+	height = 1;
+
+	// initialize meta info page
+	IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo*>(metaPage);
+	memset(metaInfo, 0, Page::SIZE);
+	strncpy(metaInfo->relationName, relationName.c_str(), sizeof(metaInfo->relationName) - 1);
+	metaInfo->attrByteOffset = attrByteOffset;
+	metaInfo->attrType = attributeType;
+	metaInfo->rootPageNo = rootPageNum;
+	metaInfo->height = height;
+	metaInfo->bufferedNodes = bufferedNodes ? 1 : 0;
+	metaInfo->partial = partial ? 1 : 0;
+	metaInfo->predicate = predicate;
+
+	bufMgr->unPinPage(file, headerPageNum, true);
+	bufMgr->unPinPage(file, rootPageNum, true);
+}
+
+void BTreeIndex::buildIndex(const std::string & relationName)
+{
+	// scan relationName and insert entries for all of the tuples in the relation into the index
+	startBuild(relationName);
+	buildStep(INT_MAX);
+	syncRelationMarker();
+}
+
+void BTreeIndex::startBuild(const std::string & relationName)
+{
+	buildScan = new FileScan(relationName, bufMgr);
+	buildingIndex = true;
+}
 
+bool BTreeIndex::buildStep(const int recordCount)
+{
+	if(buildScan == NULL) return true;
 
-	// the constructor should scan relationName and insert entries
-	// for all of the tuples in the relation into the index
-	FileScan scan(relationName, bufMgr);
 	try {
 		RecordId nextRec;
 
-		while(true) {
-			scan.scanNext(nextRec);
-			
+		for(int i = 0; i < recordCount; i++) {
+			buildScan->scanNext(nextRec);
+
 			// --- The following is taken from main.cpp:121 ---
-			// Assuming RECORD.keyIndex is our key, lets extract the key, which we know is 
-			// INTEGER and whose byte offset is also know inside the record. 
-			std::string recordStr = scan.getRecord();
+			// Assuming RECORD.keyIndex is our key, lets extract the key, which we know is
+			// INTEGER and whose byte offset is also know inside the record.
+			std::string recordStr = buildScan->getRecord();
 			const char *record = recordStr.c_str();
-			int key = attrByteOffset + *reinterpret_cast<const int*>(record); // offsetof (attributeType, keyIndex)));
-			
+			if(!coversRecord(record)) continue;
+			int key = *reinterpret_cast<const int*>(record + attrByteOffset);
+
 			insertEntry(&key, nextRec);
+			buildKeys.push_back(key);
 		}
+		return false;
 	}
 	catch(EndOfFileException const&) {
-		std::cout << "Initial file scan of " << indexName << " finished.";
+		std::cout << "Initial file scan of " << file->filename() << " finished." << std::endl;
+	}
+
+	// the scan is closed here, so the relation file is no longer written to
+	delete buildScan;
+	buildScan = NULL;
+	buildingIndex = false;
+
+	collectStats(buildKeys);
+	if(useBloomFilter) {
+		buildBloomFilter(buildKeys);
 	}
+	std::vector<int>().swap(buildKeys);
+	return true;
+}
+
+void BTreeIndex::syncRelationMarker()
+{
+	// remember which state of the relation the index reflects
+	PageId pageCount = 0;
+	std::int64_t modTime = 0;
+	readRelationMarker(relationName, pageCount, modTime);
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo*>(metaPage);
+	metaInfo->relationPageCount = pageCount;
+	metaInfo->relationModTime = modTime;
+	bufMgr->unPinPage(file, headerPageNum, true);
 }
 
 
@@ -128,60 +398,372 @@ BTreeIndex::~BTreeIndex()
 	delete the index file! But, deletion of the file object is required, which will call the
 	destructor of File class causing the index file to be closed.
 	*/
-	
-	// ends scan if it is in progress
-	if(scanExecuting) {
-		endScan();
-	}
 
-	// unpin the root page. It should be the only page still pinned.
-	bufMgr->unPinPage(file, rootPageNum, false);
+	try {
+		// ends scan if it is in progress, which unpins the only page kept pinned between calls
+		if(scanExecuting) {
+			endScan();
+		}
+
+		// an online build that didn't finish leaves the index stale, so it is rebuilt when reopened
+		if(buildScan != NULL) {
+			delete buildScan;
+			buildScan = NULL;
+		}
+
+		// statistics may have been updated by inserts since the build
+		if(statsPageNum != Page::INVALID_NUMBER) {
+			writeStats();
+		}
+		if(bloomDirty) {
+			writeBloomFilter();
+		}
+		if(freePagesDirty) {
+			writeFreePages();
+		}
+
+		// the pages left in the extents are lost with the file object unless they are saved
+		Page *metaPage;
+		bufMgr->readPage(file, headerPageNum, metaPage);
+		IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo*>(metaPage);
+		for(int i = 0; i < BlobFile::EXTENT_COUNT; i++) {
+			metaInfo->extents[i] = file->getExtent(i);
+		}
+		bufMgr->unPinPage(file, headerPageNum, true);
 
-	// flushing the index
-	bufMgr->flushFile(file);
+		// flushing the index
+		bufMgr->flushFile(file);
+	}
+	catch(BadgerDbException const&) {
+		// the destructor must not throw
+	}
 
-	// clearing up any state variables
-	delete bufMgr;
-	delete currentPageData;
+	// the buffer manager belongs to the caller, only the file object is ours
 	delete file;
 }
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::findKeyIndex
+// -----------------------------------------------------------------------------
+
+/**
+ * Returns true if a slot holding slotKey satisfies the condition of findKeyIndex().
+ */
+static inline bool keyQualifies(int slotKey, int key, bool inclusive)
+{
+	return inclusive ? slotKey >= key : slotKey > key;
+}
+
+int BTreeIndex::findKeyIndex(const int *keyArray, int length, int key, bool inclusive)
+{
+	if(length == 0) return 0;
+
+	// while binary search is selected, still sample interpolation every so often
+	// so that the index can switch back once the keys become evenly spread
+	bool probe = searchStrategy == INTERPOLATION_SEARCH;
+	if(!probe && ++searchesSinceSample >= SEARCHRESAMPLEINTERVAL) {
+		searchesSinceSample = 0;
+		probe = true;
+	}
+
+	if(!probe) {
+		searchStats.binarySearches++;
+		return binarySearchKeyIndex(keyArray, 0, length, key, inclusive);
+	}
+
+	bool hit;
+	int keyIndex = interpolationSearchKeyIndex(keyArray, length, key, inclusive, hit);
+	recordInterpolationProbe(hit);
+	return keyIndex;
+}
+
+int BTreeIndex::binarySearchKeyIndex(const int *keyArray, int low, int high, int key, bool inclusive)
+{
+	while(low < high) {
+		int middle = low + (high - low) / 2;
+		if(keyQualifies(keyArray[middle], key, inclusive))
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low;
+}
+
+int BTreeIndex::interpolationSearchKeyIndex(const int *keyArray, int length, int key, bool inclusive, bool &hit)
+{
+	int first = keyArray[0];
+	int last = keyArray[length - 1];
+
+	hit = true;
+	if(keyQualifies(first, key, inclusive)) return 0;
+	if(!keyQualifies(last, key, inclusive)) return length;
+
+	// slot 0 does not qualify and the last slot does, so first < last and the answer is in [1, length-1]
+	std::int64_t guess = (static_cast<std::int64_t>(key) - first) * (length - 1) / (static_cast<std::int64_t>(last) - first);
+	int keyIndex = guess < 1 ? 1 : (guess > length - 1 ? length - 1 : static_cast<int>(guess));
+
+	if(keyQualifies(keyArray[keyIndex], key, inclusive)) {
+		// walk left to the first qualifying slot
+		for(int steps = 0; steps < INTERPOLATIONWINDOW; steps++) {
+			if(!keyQualifies(keyArray[keyIndex - 1], key, inclusive)) return keyIndex;
+			keyIndex--;
+		}
+		hit = false;
+		return binarySearchKeyIndex(keyArray, 1, keyIndex, key, inclusive);
+	}
+
+	// walk right to the first qualifying slot
+	for(int steps = 0; steps < INTERPOLATIONWINDOW; steps++) {
+		keyIndex++;
+		if(keyQualifies(keyArray[keyIndex], key, inclusive)) return keyIndex;
+	}
+	hit = false;
+	return binarySearchKeyIndex(keyArray, keyIndex + 1, length, key, inclusive);
+}
+
+void BTreeIndex::recordInterpolationProbe(bool hit)
+{
+	searchStats.interpolationProbes++;
+	if(hit) {
+		searchStats.interpolationHits++;
+		windowHits++;
+	}
+
+	if(++windowProbes < SEARCHSTATSWINDOW) return;
+
+	// end of the window: keep interpolating only while it lands close enough often enough
+	SearchStrategy chosen = windowHits * 100 >= windowProbes * INTERPOLATIONHITPERCENT ? INTERPOLATION_SEARCH : BINARY_SEARCH;
+	if(chosen != searchStrategy) {
+		searchStrategy = chosen;
+		searchStats.strategySwitches++;
+	}
+	windowProbes = 0;
+	windowHits = 0;
+}
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::insertEntry
 // -----------------------------------------------------------------------------
 
+/**
+ * Returns the message buffer of a non-leaf node of an index with buffered nodes.
+ */
+static inline IndexMessage *nodeMessages(NonLeafNodeInt *node)
+{
+	return reinterpret_cast<IndexMessage*>(&node->keyArray[BUFFEREDNONLEAFSIZE]);
+}
+
+/**
+ * Returns the number of messages in the buffer of a non-leaf node of an index with buffered nodes.
+ */
+static inline PageId &nodeMessageCount(NonLeafNodeInt *node)
+{
+	return node->pageNoArray[INTARRAYNONLEAFSIZE];
+}
+
+/**
+ * Orders messages by key, then by record id.
+ */
+static bool messageLess(const IndexMessage &m1, const IndexMessage &m2)
+{
+	if(m1.key != m2.key) return m1.key < m2.key;
+	if(m1.pageNo != m2.pageNo) return m1.pageNo < m2.pageNo;
+	return m1.slotNo < m2.slotNo;
+}
+
+/**
+ * Orders messages by key only. Used with a stable sort, so messages for the same entry keep their order.
+ */
+static bool messageKeyLess(const IndexMessage &m1, const IndexMessage &m2)
+{
+	return m1.key < m2.key;
+}
+
 NonLeafNodeInt BTreeIndex::getNonLeafNodeFromPage(PageId pageId) {
 	Page* p;
 	bufMgr->readPage(file, pageId, p);
-	NonLeafNodeInt* node = reinterpret_cast<NonLeafNodeInt*>(p);
-	return *node;
+	NonLeafNodeInt node = *reinterpret_cast<NonLeafNodeInt*>(p);
+	bufMgr->unPinPage(file, pageId, false);
+	return node;
 }
 
 NonLeafNodeInt BTreeIndex::getRootNode() {
 	return getNonLeafNodeFromPage(rootPageNum);
 }
 
-void BTreeIndex::insertEntry(const void *key, const RecordId rid) 
+int BTreeIndex::getLeafOccupancy(const LeafNodeInt *Node_leaf) {
+	int low = 0;
+	int high = leafOccupancy;
+	while(low < high) {
+		int middle = low + (high - low) / 2;
+		if(Node_leaf->ridArray[middle].page_number == Page::INVALID_NUMBER)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low;
+}
+
+int BTreeIndex::getNonLeafOccupancy(const NonLeafNodeInt *Node_nonleaf) {
+	int low = 0;
+	int high = nodeOccupancy + 1;
+	while(low < high) {
+		int middle = low + (high - low) / 2;
+		if(Node_nonleaf->pageNoArray[middle] == Page::INVALID_NUMBER)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low > 0 ? low - 1 : 0;
+}
+
+void BTreeIndex::insertEntry(const void *key, const RecordId rid)
 {
 	/*
 	Start from root and recursively search for which leaf key belongs to
 	If leaf is full then split leaf, update parent non-leaf, and if root needs splitting then update metadata
-	Might have to keep track of height here
 	*/
-	// You have to add the node page to the buffer manager if there is space. Maybe use allocPage???
-	// NonLeafNodeInt root = getRootNode();
 
 	RIDKeyPair<int> current_data_to_enter;
 	current_data_to_enter.set(rid, *((int *)key));
 
+	if(!buildingIndex) {
+		updateStats(current_data_to_enter.key);
+	}
+	bloomAdd(current_data_to_enter.key);
+	if(modelValid) {
+		invalidateModel();
+	}
+
+	// with buffered nodes the entry waits in the root until it goes down in a batch
+	if(bufferedNodes && !buildingIndex && rootPageNum != initialRootPageNum) {
+		enqueueMessage(current_data_to_enter.key, rid, true);
+		return;
+	}
+	insertIntoTree(current_data_to_enter);
+}
+
+void BTreeIndex::insertIntoTree(const RIDKeyPair<int> & current_data_to_enter)
+{
 	Page* rootPage;
+	PageId oldRootPageNum = rootPageNum;
 
 	bufMgr->readPage(file, rootPageNum, rootPage);
   	PageKeyPair<int> *child_data = nullptr;
-	
+
 	search(rootPage, rootPageNum, initialRootPageNum == rootPageNum ? true : false, current_data_to_enter, child_data);
+
+	// the root itself was split
+	if(child_data != nullptr) {
+		root_changer(oldRootPageNum, child_data);
+		delete child_data;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::deleteEntry(const void *key, const RecordId rid)
+{
+	int keyInt = *reinterpret_cast<const int*>(key);
+
+	if(bufferedNodes && rootPageNum != initialRootPageNum) {
+		if(!containsEntry(key, rid)) {
+			throw NoSuchKeyFoundException();
+		}
+		enqueueMessage(keyInt, rid, false);
+	}
+	else if(!deleteFromTree(keyInt, rid)) {
+		throw NoSuchKeyFoundException();
+	}
+	if(modelValid) {
+		invalidateModel();
+	}
+
+	removeStats(keyInt);
+}
+
+bool BTreeIndex::deleteFromTree(int key, const RecordId & rid)
+{
+	PageId pageNum;
+	Page *page;
+	int keyIndex;
+	if(!findEntry(key, rid, pageNum, page, keyIndex)) {
+		return false;
+	}
+
+	// leaves are not merged, an emptied leaf just stays in the sibling chain
+	LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+	int keyCount = getLeafOccupancy(leaf);
+	for(int i = keyIndex; i < keyCount - 1; i++) {
+		leaf->keyArray[i] = leaf->keyArray[i+1];
+		leaf->ridArray[i] = leaf->ridArray[i+1];
+	}
+	leaf->keyArray[keyCount - 1] = 0;
+	memset(&leaf->ridArray[keyCount - 1], 0, sizeof(RecordId));
+	leaf->version++;
+	bufMgr->unPinPage(file, pageNum, true);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::containsEntry
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::containsEntry(const void *key, const RecordId rid)
+{
+	int keyInt = *reinterpret_cast<const int*>(key);
+
+	// a buffered message is newer than the leaves
+	if(bufferedNodes) {
+		int pending = pendingMessage(keyInt, rid);
+		if(pending >= 0) return pending == 1;
+	}
+
+	PageId pageNum;
+	Page *page;
+	int keyIndex;
+	if(!findEntry(keyInt, rid, pageNum, page, keyIndex)) {
+		return false;
+	}
+
+	bufMgr->unPinPage(file, pageNum, false);
+	return true;
+}
+
+bool BTreeIndex::findEntry(int key, const RecordId & rid, PageId & pageNum, Page *& page, int & keyIndex)
+{
+	if(!bloomMayContain(key)) return false;
+
+	descendToLeaf(key, Operator::GTE, pageNum, page);
+	bool keyFound = false;
+
+	// entries with the same key may continue in the right siblings
+	while(true)
+	{
+		LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+		int keyCount = getLeafOccupancy(leaf);
+		keyIndex = findKeyIndex(leaf->keyArray, keyCount, key, true);
+
+		for(; keyIndex < keyCount && leaf->keyArray[keyIndex] == key; keyIndex++) {
+			if(leaf->ridArray[keyIndex] == rid) return true;
+			keyFound = true;
+		}
+
+		if(keyIndex < keyCount || leaf->rightSibPageNo == Page::INVALID_NUMBER) {
+			bufMgr->unPinPage(file, pageNum, false);
+			if(!keyFound) recordBloomFalsePositive();
+			return false;
+		}
+
+		PageId nextPage = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		pageNum = nextPage;
+		bufMgr->readPage(file, pageNum, page);
+	}
 }
-//Under Construction
+
 void BTreeIndex::search(Page *Page_currently, PageId Page_number_currently, bool is_leaf, const RIDKeyPair<int> current_data_to_enter
 , PageKeyPair<int> *&child_data){
 	if(!is_leaf) {
@@ -201,183 +783,1809 @@ void BTreeIndex::search(Page *Page_currently, PageId Page_number_currently, bool
 		else{
 			if(Node_currently->pageNoArray[nodeOccupancy]==0){
 				insert_into_nonleaf(Node_currently, child_data);
-				child_data == nullptr;
+				delete child_data;
+				child_data = nullptr;
 				bufMgr -> unPinPage(file,Page_number_currently,true);
 			}
 			else {
-				// making this now
-				splitter();
+				splitter(Node_currently, Page_number_currently, child_data);
 			}
 		}
 
 	}
+	else {
+		LeafNodeInt *Node_leaf = reinterpret_cast<LeafNodeInt *>(Page_currently);
+		if(Node_leaf->ridArray[leafOccupancy - 1].page_number == Page::INVALID_NUMBER) {
+			insert_into_leaf(Node_leaf, current_data_to_enter);
+			child_data = nullptr;
+			bufMgr->unPinPage(file, Page_number_currently, true);
+		}
+		else {
+			leaf_splitter(Node_leaf, Page_number_currently, current_data_to_enter, child_data);
+		}
+	}
 }
 
 void BTreeIndex::NextNonLeafNode(NonLeafNodeInt *Node_currently, PageId &node_next_number, int key){
-	int keyIndex = nodeOccupancy;
-	while((keyIndex>=0)&& (Node_currently->pageNoArray[keyIndex] == 0)) {
-		keyIndex--;
-	}
-	while((keyIndex>0) && (Node_currently->keyArray[keyIndex] >= key)) {
-		keyIndex--;
-	}
+	// keys equal to a separator were copied up from the right child, so they go right
+	int keyIndex = findKeyIndex(Node_currently->keyArray, getNonLeafOccupancy(Node_currently), key, false);
 	node_next_number = Node_currently->pageNoArray[keyIndex];
 }
 
 void BTreeIndex::insert_into_nonleaf(NonLeafNodeInt *Node_nonleaf, PageKeyPair<int> *key_and_page){
-	int keyIndex = nodeOccupancy;
-	while((keyIndex>=0)&&(Node_nonleaf->pageNoArray[keyIndex]==0)){
-		keyIndex--;
-	}
-	while((keyIndex>0)&&(Node_leaf->keyArray[keyIndex-1]>key_and_page->key)){
-		Node_nonleaf -> keyArray[keyIndex] = Node_nonleaf -> keyArray[keyIndex-1];
-		Node_nonleaf -> pageNoArray[keyIndex+1] = Node_nonleaf -> pageNoArray[keyIndex];
-		keyIndex--;
+	int keyCount = getNonLeafOccupancy(Node_nonleaf);
+	int keyIndex = findKeyIndex(Node_nonleaf->keyArray, keyCount, key_and_page->key, false);
+	for(int i = keyCount; i > keyIndex; i--){
+		Node_nonleaf -> keyArray[i] = Node_nonleaf -> keyArray[i-1];
+		Node_nonleaf -> pageNoArray[i+1] = Node_nonleaf -> pageNoArray[i];
 	}
 	Node_nonleaf -> keyArray[keyIndex] = key_and_page->key;
 	Node_nonleaf -> pageNoArray[keyIndex+1] = key_and_page->pageNo;
 }
 
-// under construction
-void BTreeIndex::splitter(NonLeafNodeInt node_old, PageId page_num_old, PageKeyPair<int> *&child_data){
-	PageId newNum;
-	Page newP;
-	BufMgr->allocPage(file,newNum,newP);
-	NonLeafNodeInt *node_new = (NonLeafNodeInt *)newP;
-
-	int middle_key = nodeOccupancy/2;
-	PageKeyPair<int> other_node_entry;
+void BTreeIndex::insert_into_leaf(LeafNodeInt *Node_leaf, const RIDKeyPair<int> key_and_rid){
+	int keyCount = getLeafOccupancy(Node_leaf);
+	// duplicates are appended after the existing entries with the same key
+	int keyIndex = findKeyIndex(Node_leaf->keyArray, keyCount, key_and_rid.key, false);
+	for(int i = keyCount; i > keyIndex; i--){
+		Node_leaf -> keyArray[i] = Node_leaf -> keyArray[i-1];
+		Node_leaf -> ridArray[i] = Node_leaf -> ridArray[i-1];
+	}
+	Node_leaf -> keyArray[keyIndex] = key_and_rid.key;
+	Node_leaf -> ridArray[keyIndex] = key_and_rid.rid;
+	Node_leaf -> version++;
+}
 
-	other_node_entry.set(newNum, node_old->keyArray[middle_key])
-	middle_key = node_1_key + 1;
+void BTreeIndex::splitter(NonLeafNodeInt *node_old, PageId page_num_old, PageKeyPair<int> *&child_data){
+	PageId newNum;
+	Page *newP;
+	allocNodePage(false, newNum, newP);
+	NonLeafNodeInt *node_new = reinterpret_cast<NonLeafNodeInt *>(newP);
+
+	// the buffer is cleared along with the keys, so it is put aside first
+	std::vector<IndexMessage> messages;
+	if(bufferedNodes) {
+		messages.assign(nodeMessages(node_old), nodeMessages(node_old) + nodeMessageCount(node_old));
+	}
 
-	for(int i = middle_key, i < nodeOccupancy, i++){
-		node_new->keyArray[i-middle_key] = node_old->keyArray[i];
-		node_old->keyArray[i+1]=0;
-		node_new->pageNoArray[i-middle_key] = node_old->pageNoArray[i+1];
-		node_old->pageNoArray[i+1]=(PageId) 0;
+	// lay out the full node plus the pending entry, then hand out the halves
+	int keys[INTARRAYNONLEAFSIZE + 1];
+	PageId pages[INTARRAYNONLEAFSIZE + 2];
+	int keyIndex = findKeyIndex(node_old->keyArray, nodeOccupancy, child_data->key, false);
+	for(int i = 0, j = 0; i <= nodeOccupancy; i++){
+		keys[i] = (i == keyIndex) ? child_data->key : node_old->keyArray[j++];
 	}
-	node_new->level = node_old->level;
-	//have to set old nodes's 
-	if(key<node_new->keyArray[0]){
-		insert_into_nonleaf(node_old, child_data);
+	for(int i = 0, j = 0; i <= nodeOccupancy + 1; i++){
+		pages[i] = (i == keyIndex + 1) ? child_data->pageNo : node_old->pageNoArray[j++];
 	}
-	else if(key>=node_new->keyArray[0]){
-		insert_into_nonleaf(node_new, child_data);
+
+	// the middle key moves up; it is kept in neither half
+	int middle_key = (nodeOccupancy + 1) / 2;
+	memset(node_old->keyArray, 0, sizeof(node_old->keyArray));
+	memset(node_old->pageNoArray, 0, sizeof(node_old->pageNoArray));
+	for(int i = 0; i < middle_key; i++){
+		node_old->keyArray[i] = keys[i];
+		node_old->pageNoArray[i] = pages[i];
+	}
+	node_old->pageNoArray[middle_key] = pages[middle_key];
+	for(int i = middle_key + 1; i <= nodeOccupancy; i++){
+		node_new->keyArray[i-middle_key-1] = keys[i];
+		node_new->pageNoArray[i-middle_key-1] = pages[i];
 	}
-	child_data = &other_node_entry;
-	BufMgr->unPinPage(file,page_num_old,true);
-	BufMgr->unPinPage(file,newP, true);
-	
-	if(page_num_old == rootPageNum){
-		//gotta make this
-		root_changer(page_num_old, child_data);
+	node_new->pageNoArray[nodeOccupancy-middle_key] = pages[nodeOccupancy+1];
+	node_new->level = node_old->level;
+
+	// messages follow the keys they are routed by
+	for(std::size_t i = 0; i < messages.size(); i++){
+		NonLeafNodeInt *node = messages[i].key < keys[middle_key] ? node_old : node_new;
+		nodeMessages(node)[nodeMessageCount(node)++] = messages[i];
 	}
-	
+
+	child_data->set(newNum, keys[middle_key]);
+	bufMgr->unPinPage(file,page_num_old,true);
+	bufMgr->unPinPage(file,newNum, true);
 }
 
-PageId BTreeIndex::findLeastPageId(NonLeafNodeInt node, int lowValParam, Operator greaterThan) {
-	int keyArrLength = sizeof(node.keyArray) / sizeof(node.keyArray[0]);
-	int key;
-	
-	for (int keyIndex = 0; keyIndex < keyArrLength; keyIndex++)
-	{		
-		key = node.keyArray[keyIndex];
-		if(lowValParam < key) return node.pageNoArray[keyIndex];
+void BTreeIndex::leaf_splitter(LeafNodeInt *leaf_old, PageId page_num_old, const RIDKeyPair<int> key_and_rid, PageKeyPair<int> *&child_data){
+	PageId newNum;
+	Page *newP;
+	allocNodePage(true, newNum, newP);
+	LeafNodeInt *leaf_new = reinterpret_cast<LeafNodeInt *>(newP);
+
+	// after the insert the old leaf keeps middle entries and the new one the rest
+	int middle = (leafOccupancy + 1) / 2;
+	int keyIndex = findKeyIndex(leaf_old->keyArray, leafOccupancy, key_and_rid.key, false);
+	int moveFrom = keyIndex < middle ? middle - 1 : middle;
+
+	for(int i = moveFrom; i < leafOccupancy; i++){
+		leaf_new->keyArray[i-moveFrom] = leaf_old->keyArray[i];
+		leaf_new->ridArray[i-moveFrom] = leaf_old->ridArray[i];
+		leaf_old->keyArray[i] = 0;
+		memset(&leaf_old->ridArray[i], 0, sizeof(RecordId));
 	}
-	return node.pageNoArray[keyArrLength];
+
+	if(keyIndex < middle)
+		insert_into_leaf(leaf_old, key_and_rid);
+	else
+		insert_into_leaf(leaf_new, key_and_rid);
+
+	leaf_new->rightSibPageNo = leaf_old->rightSibPageNo;
+	leaf_old->rightSibPageNo = newNum;
+	leaf_old->version++;
+
+	// the first key of the new leaf is copied up
+	child_data = new PageKeyPair<int>();
+	child_data->set(newNum, leaf_new->keyArray[0]);
+	bufMgr->unPinPage(file,page_num_old,true);
+	bufMgr->unPinPage(file,newNum, true);
+}
+
+void BTreeIndex::root_changer(PageId page_num_old, PageKeyPair<int> *child_data){
+	PageId newRootNum;
+	Page *newRootPage;
+	allocNodePage(false, newRootNum, newRootPage);
+	NonLeafNodeInt *newRoot = reinterpret_cast<NonLeafNodeInt *>(newRootPage);
+
+	// level 1 if the old root was the leaf root, otherwise another non-leaf level
+	newRoot->level = page_num_old == initialRootPageNum ? 1 : 0;
+	newRoot->keyArray[0] = child_data->key;
+	newRoot->pageNoArray[0] = page_num_old;
+	newRoot->pageNoArray[1] = child_data->pageNo;
+	bufMgr->unPinPage(file, newRootNum, true);
+
+	rootPageNum = newRootNum;
+	height++;
+
+	// the meta page always points at the current root
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo*>(metaPage);
+	metaInfo->rootPageNo = rootPageNum;
+	metaInfo->height = height;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+PageId BTreeIndex::findLeastPageId(NonLeafNodeInt *node, int lowValParam, Operator greaterThan) {
+	// GTE has to start left of a separator equal to the low value, GT can start right of it
+	int keyIndex = findKeyIndex(node->keyArray, getNonLeafOccupancy(node), lowValParam, greaterThan == GTE);
+	return node->pageNoArray[keyIndex];
 }
 
 // -----------------------------------------------------------------------------
-// BTreeIndex::startScan
+// BTreeIndex::flushMessages
 // -----------------------------------------------------------------------------
 
-void BTreeIndex::startScan(const void* lowValParm,
-				   const Operator lowOpParm,
-				   const void* highValParm,
-				   const Operator highOpParm)
+void BTreeIndex::enqueueMessage(int key, const RecordId & rid, bool insert)
 {
-	/*
-	This method is used to begin a “filtered scan” of the index. For example, if the
-	method is called using arguments (1,GT,100,LTE), then the scan should seek all
-	entries greater than 1 and less than or equal to 100.
-	*/
-
-	if(lowValParm > highValParm) throw BadScanrangeException();
-	if(lowOpParm != Operator::GT && lowOpParm != Operator::GTE) throw BadOpcodesException();
-	if(highOpParm != Operator::LT && highOpParm != Operator::LTE) throw BadOpcodesException();
-
-	scanExecuting = true;
+	Page *page;
+	bufMgr->readPage(file, rootPageNum, page);
+	NonLeafNodeInt *root = reinterpret_cast<NonLeafNodeInt*>(page);
+
+	// flushing the root may split it, so the root is looked up again every time
+	while(nodeMessageCount(root) == static_cast<PageId>(MESSAGEBUFFERSIZE)) {
+		PageId oldRootPageNum = rootPageNum;
+		bufMgr->unPinPage(file, oldRootPageNum, false);
+		flushNode(oldRootPageNum);
+		bufMgr->readPage(file, rootPageNum, page);
+		root = reinterpret_cast<NonLeafNodeInt*>(page);
+	}
 
-	// Sets data in the provided parameters for scanNext()
-	lowValInt	= *reinterpret_cast<const int*>(lowValParm);
-	highValInt	= *reinterpret_cast<const int*>(highValParm);
-	lowOp 		= lowOpParm;
-	highOp		= highOpParm;
-
-	// Get the root to start the scan
-	NonLeafNodeInt nextNode = getRootNode();
-	LeafNodeInt leaf;
-	PageId traversalPageId = rootPageNum;
+	IndexMessage& message = nodeMessages(root)[nodeMessageCount(root)++];
+	message.key = key;
+	message.pageNo = rid.page_number;
+	message.slotNo = rid.slot_number;
+	message.insert = insert ? 1 : 0;
+	bufMgr->unPinPage(file, rootPageNum, true);
+}
 
-	// scan continues until a proper leaf node is found
-	while (1)
+void BTreeIndex::flushNode(PageId nodeNum)
+{
+	while(true)
 	{
-		// if the next node is the last level, then the next level has leaf nodes.
-		PageId pageId = findLeastPageId(nextNode, lowValInt, lowOpParm);
-		
-		if(nextNode.level) {
-			Page* p;
-			bufMgr->readPage(file, pageId, p);
-			leaf = *reinterpret_cast<LeafNodeInt*>(p);
+		Page *page;
+		bufMgr->readPage(file, nodeNum, page);
+		NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+		int count = static_cast<int>(nodeMessageCount(node));
+		if(count == 0) {
+			bufMgr->unPinPage(file, nodeNum, false);
+			return;
+		}
+
+		// the child receiving the most messages gets them all in one go
+		IndexMessage *messages = nodeMessages(node);
+		int keyCount = getNonLeafOccupancy(node);
+		std::vector<int> childIndex(count);
+		std::vector<int> perChild(keyCount + 1, 0);
+		for(int i = 0; i < count; i++) {
+			childIndex[i] = findKeyIndex(node->keyArray, keyCount, messages[i].key, false);
+			perChild[childIndex[i]]++;
+		}
+		int child = static_cast<int>(std::max_element(perChild.begin(), perChild.end()) - perChild.begin());
+		PageId childNum = node->pageNoArray[child];
+
+		if(node->level != 1) {
+			Page *childPage;
+			bufMgr->readPage(file, childNum, childPage);
+			NonLeafNodeInt *childNode = reinterpret_cast<NonLeafNodeInt*>(childPage);
+
+			// flushing the child may split it, so the batch is worked out again afterwards
+			if(static_cast<int>(nodeMessageCount(childNode)) + perChild[child] > MESSAGEBUFFERSIZE) {
+				bufMgr->unPinPage(file, childNum, false);
+				bufMgr->unPinPage(file, nodeNum, false);
+				flushNode(childNum);
+				continue;
+			}
 
-			// if it's not the root, unpin the last nonleafnode
-			if(traversalPageId != rootPageNum) {
-				bufMgr->unPinPage(file, traversalPageId, false);
+			int kept = 0;
+			for(int i = 0; i < count; i++) {
+				if(childIndex[i] == child)
+					nodeMessages(childNode)[nodeMessageCount(childNode)++] = messages[i];
+				else
+					messages[kept++] = messages[i];
 			}
+			nodeMessageCount(node) = kept;
+			bufMgr->unPinPage(file, childNum, true);
+			bufMgr->unPinPage(file, nodeNum, true);
+			return;
+		}
 
-			// this is the pageNum we're looking for
-			currentPageNum = pageId;
-			currentPageData = p;
+		// the batch for a leaf is taken out before it is applied, since applying it may split this node
+		std::vector<IndexMessage> batch;
+		int kept = 0;
+		for(int i = 0; i < count; i++) {
+			if(childIndex[i] == child)
+				batch.push_back(messages[i]);
+			else
+				messages[kept++] = messages[i];
 		}
-		else {
-			// if it's not the root, unpin the last nonleafnode
-			if(traversalPageId != rootPageNum) {
-				bufMgr->unPinPage(file, traversalPageId, false);
+		nodeMessageCount(node) = kept;
+		bufMgr->unPinPage(file, nodeNum, true);
+
+		std::stable_sort(batch.begin(), batch.end(), messageKeyLess);
+		for(std::size_t i = 0; i < batch.size(); i++) {
+			RecordId rid;
+			rid.page_number = batch[i].pageNo;
+			rid.slot_number = batch[i].slotNo;
+			if(batch[i].insert) {
+				RIDKeyPair<int> entry;
+				entry.set(rid, batch[i].key);
+				insertIntoTree(entry);
+			}
+			else {
+				deleteFromTree(batch[i].key, rid);
 			}
-			traversalPageId = pageId;
-			nextNode = getNonLeafNodeFromPage(pageId);
 		}
+		return;
 	}
+}
 
-	// scan continues until a proper leaf node is found for scanNext
-	int leafRidLength = sizeof(leaf.ridArray) / sizeof(leaf.ridArray[0]);
-	for (int keyIndex = 0; keyIndex < leafRidLength; keyIndex++)
-	{
-		// Determine correct operator comparison
-		int key = leaf.keyArray[keyIndex];
-		bool comparison;
-		if(lowOp == Operator::GT) 
-			comparison = key > lowValInt;
-		else if(lowOp == Operator::GTE)
-			comparison = key >= lowValInt;
+void BTreeIndex::flushMessages()
+{
+	if(!bufferedNodes) return;
 
-		// sets the next entry + sets page data
-		if(comparison) {
-			nextEntry = keyIndex;
-			break;
-		}
+	PageId nodeNum;
+	while((nodeNum = findBufferedNode()) != Page::INVALID_NUMBER) {
+		flushNode(nodeNum);
 	}
-
-	// nothing satisifies the scan
-	nextEntry = -1;
+}
+
+int BTreeIndex::countPendingMessages()
+{
+	std::vector<IndexMessage> messages;
+	gatherMessages(messages);
+	return static_cast<int>(messages.size());
+}
+
+PageId BTreeIndex::findBufferedNode()
+{
+	if(!bufferedNodes || rootPageNum == initialRootPageNum) return Page::INVALID_NUMBER;
+
+	std::vector<PageId> level(1, rootPageNum);
+	while(!level.empty())
+	{
+		std::vector<PageId> below;
+		for(std::size_t i = 0; i < level.size(); i++) {
+			Page *page;
+			bufMgr->readPage(file, level[i], page);
+			NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+			bool buffered = nodeMessageCount(node) > 0;
+			if(!buffered && node->level != 1) {
+				below.insert(below.end(), node->pageNoArray, node->pageNoArray + getNonLeafOccupancy(node) + 1);
+			}
+			bufMgr->unPinPage(file, level[i], false);
+			if(buffered) return level[i];
+		}
+		level.swap(below);
+	}
+	return Page::INVALID_NUMBER;
+}
+
+void BTreeIndex::gatherMessages(std::vector<IndexMessage> & messages)
+{
+	messages.clear();
+	if(!bufferedNodes || rootPageNum == initialRootPageNum) return;
+
+	// the tree is balanced, so every node of a level is as far from the leaves
+	std::vector< std::vector<IndexMessage> > levels;
+	std::vector<PageId> level(1, rootPageNum);
+	while(!level.empty())
+	{
+		std::vector<PageId> below;
+		levels.push_back(std::vector<IndexMessage>());
+		for(std::size_t i = 0; i < level.size(); i++) {
+			Page *page;
+			bufMgr->readPage(file, level[i], page);
+			NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+			levels.back().insert(levels.back().end(), nodeMessages(node), nodeMessages(node) + nodeMessageCount(node));
+			if(node->level != 1) {
+				below.insert(below.end(), node->pageNoArray, node->pageNoArray + getNonLeafOccupancy(node) + 1);
+			}
+			bufMgr->unPinPage(file, level[i], false);
+		}
+		level.swap(below);
+	}
+
+	// messages only move down, so deeper ones are older
+	for(std::size_t i = levels.size(); i-- > 0; ) {
+		messages.insert(messages.end(), levels[i].begin(), levels[i].end());
+	}
+}
+
+int BTreeIndex::pendingMessage(int key, const RecordId & rid)
+{
+	if(rootPageNum == initialRootPageNum) return -1;
+
+	PageId pageNum = rootPageNum;
+	while(true)
+	{
+		Page *page;
+		bufMgr->readPage(file, pageNum, page);
+		NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+
+		// the newest message is the last one in the highest buffer holding one
+		IndexMessage *messages = nodeMessages(node);
+		for(int i = static_cast<int>(nodeMessageCount(node)) - 1; i >= 0; i--) {
+			if(messages[i].key == key && messages[i].pageNo == rid.page_number && messages[i].slotNo == rid.slot_number) {
+				int insert = messages[i].insert;
+				bufMgr->unPinPage(file, pageNum, false);
+				return insert;
+			}
+		}
+
+		bool lastLevel = node->level == 1;
+		PageId nextPage;
+		NextNonLeafNode(node, nextPage, key);
+		bufMgr->unPinPage(file, pageNum, false);
+		if(lastLevel) return -1;
+		pageNum = nextPage;
+	}
+}
+
+void BTreeIndex::prepareBufferedScan()
+{
+	std::vector<IndexMessage> messages;
+	gatherMessages(messages);
+
+	// the newest message of an entry, the last of its run after a stable sort, decides whether it exists
+	std::stable_sort(messages.begin(), messages.end(), messageLess);
+	for(std::size_t i = 0; i < messages.size(); i++)
+	{
+		if(i + 1 < messages.size() && !messageLess(messages[i], messages[i + 1])) continue;
+
+		int key = messages[i].key;
+		bool inRange = false;
+		for(std::size_t r = 0; r < scanRanges.size() && !inRange; r++) {
+			const KeyRange<int>& range = scanRanges[r];
+			inRange = (range.lowOp == Operator::GTE ? key >= range.lowVal : key > range.lowVal) &&
+				(range.highOp == Operator::LTE ? key <= range.highVal : key < range.highVal);
+		}
+		if(!inRange) continue;
+
+		scanMessages.push_back(messages[i]);
+		if(messages[i].insert) {
+			scanInserts.push_back(messages[i]);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::bloomMayContain
+// -----------------------------------------------------------------------------
+
+/**
+ * Mixes the bits of a key (the finalizer of MurmurHash3). The high half picks the block,
+ * the low half picks the bits within it.
+ */
+static std::uint64_t bloomHash(int key)
+{
+	std::uint64_t hash = static_cast<std::uint32_t>(key);
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/**
+ * Computes the bit a hash sets in every word of its block, each word with its own odd multiplier.
+ */
+static void bloomMasks(std::uint64_t hash, std::uint64_t masks[BLOOMBLOCKWORDS])
+{
+	static const std::uint32_t salts[BLOOMBLOCKWORDS] = {
+		0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+		0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+
+	std::uint32_t low = static_cast<std::uint32_t>(hash);
+	for(int i = 0; i < BLOOMBLOCKWORDS; i++) {
+		masks[i] = std::uint64_t(1) << ((low * salts[i]) >> 26);
+	}
+}
+
+/**
+ * Maps a hash onto one of blockCount blocks without a division.
+ */
+static std::size_t bloomBlockIndex(std::uint64_t hash, std::size_t blockCount)
+{
+	return static_cast<std::size_t>(((hash >> 32) * blockCount) >> 32);
+}
+
+bool BTreeIndex::bloomMayContain(int key)
+{
+	if(bloomBlocks.empty()) return true;
+
+	std::uint64_t hash = bloomHash(key);
+	std::uint64_t masks[BLOOMBLOCKWORDS];
+	bloomMasks(hash, masks);
+	const BloomBlock& block = bloomBlocks[bloomBlockIndex(hash, bloomBlocks.size())];
+
+	// no early exit, so the words are tested side by side
+	std::uint64_t missing = 0;
+	for(int i = 0; i < BLOOMBLOCKWORDS; i++) {
+		missing |= masks[i] & ~block.words[i];
+	}
+	if(missing == 0) return true;
+
+	bloomStats.negatives++;
+	bloomWindowLookups++;
+	return false;
+}
+
+void BTreeIndex::bloomAdd(int key)
+{
+	if(bloomBlocks.empty()) return;
+
+	std::uint64_t hash = bloomHash(key);
+	std::uint64_t masks[BLOOMBLOCKWORDS];
+	bloomMasks(hash, masks);
+	BloomBlock& block = bloomBlocks[bloomBlockIndex(hash, bloomBlocks.size())];
+	for(int i = 0; i < BLOOMBLOCKWORDS; i++) {
+		block.words[i] |= masks[i];
+	}
+	bloomDirty = true;
+}
+
+void BTreeIndex::recordBloomFalsePositive()
+{
+	if(bloomBlocks.empty()) return;
+
+	bloomStats.falsePositives++;
+	bloomWindowFalsePositives++;
+	bloomWindowLookups++;
+	if(bloomWindowLookups < BLOOMSTATSWINDOW) return;
+
+	// deleted keys leave their bits set, and inserts past the size the filter was built for fill it up
+	bool drifted = bloomWindowFalsePositives * 100 > bloomWindowLookups * BLOOMMAXFALSEPOSITIVEPERCENT;
+	bloomWindowLookups = 0;
+	bloomWindowFalsePositives = 0;
+	if(drifted) {
+		bloomStats.rebuilds++;
+		rebuildBloomFilter();
+	}
+}
+
+void BTreeIndex::buildBloomFilter(const std::vector<int>& keys)
+{
+	std::size_t blockBits = BLOOMBLOCKWORDS * 64;
+	std::size_t blockCount = std::max<std::size_t>(1, (keys.size() * BLOOMBITSPERKEY + blockBits - 1) / blockBits);
+	bloomBlocks.assign(blockCount, BloomBlock());
+
+	for(std::size_t i = 0; i < keys.size(); i++) {
+		bloomAdd(keys[i]);
+	}
+	bloomWindowLookups = 0;
+	bloomWindowFalsePositives = 0;
+	writeBloomFilter();
+}
+
+void BTreeIndex::rebuildBloomFilter()
+{
+	std::vector<int> keys;
+	PageId pageNum;
+	Page *page;
+	descendToLeaf(INT_MIN, Operator::GTE, pageNum, page);
+
+	while(true)
+	{
+		LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+		int keyCount = getLeafOccupancy(leaf);
+		keys.insert(keys.end(), leaf->keyArray, leaf->keyArray + keyCount);
+
+		PageId nextPage = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		if(nextPage == Page::INVALID_NUMBER) break;
+		pageNum = nextPage;
+		bufMgr->readPage(file, pageNum, page);
+	}
+
+	// entries still buffered are in the index too
+	std::vector<IndexMessage> messages;
+	gatherMessages(messages);
+	for(std::size_t i = 0; i < messages.size(); i++) {
+		if(messages[i].insert) keys.push_back(messages[i].key);
+	}
+
+	buildBloomFilter(keys);
+}
+
+void BTreeIndex::writeBloomFilter()
+{
+	int blockCount = static_cast<int>(bloomBlocks.size());
+	int pageCount = (blockCount + BLOOMBLOCKSPERPAGE - 1) / BLOOMBLOCKSPERPAGE;
+
+	// a filter that outgrew its pages moves to a new run; the old pages are left unused like emptied leaves
+	if(pageCount > bloomPageCount) {
+		bloomPageNum = file->reservePages(pageCount);
+		bloomPageCount = pageCount;
+	}
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo*>(metaPage);
+	metaInfo->bloomPageNo = bloomPageNum;
+	metaInfo->bloomPageCount = bloomPageCount;
+	metaInfo->bloomBlockCount = blockCount;
+	bufMgr->unPinPage(file, headerPageNum, true);
+
+	for(int i = 0; i < pageCount; i++) {
+		int first = i * BLOOMBLOCKSPERPAGE;
+		int count = std::min(BLOOMBLOCKSPERPAGE, blockCount - first);
+
+		Page *bloomPage;
+		bufMgr->readPage(file, bloomPageNum + i, bloomPage);
+		BloomBlock *blocks = reinterpret_cast<BloomBlock*>(bloomPage);
+		memset(blocks, 0, Page::SIZE);
+		memcpy(blocks, &bloomBlocks[first], count * sizeof(BloomBlock));
+		bufMgr->unPinPage(file, bloomPageNum + i, true);
+	}
+	bloomDirty = false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::trainModel
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::trainModel()
+{
+	// the model describes the leaves, so nothing may be left in the buffers
+	flushMessages();
+
+	modelValid = false;
+	modelSegments.clear();
+	modelLeafPages.clear();
+	modelLeafStarts.clear();
+
+	// the first entry of every distinct key, with its position across the leaf level
+	std::vector<int> pointKeys;
+	std::vector<int> pointPositions;
+	int position = 0;
+	PageId pageNum;
+	Page *page;
+	descendToLeaf(INT_MIN, Operator::GTE, pageNum, page);
+
+	while(true)
+	{
+		LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+		int keyCount = getLeafOccupancy(leaf);
+		modelLeafPages.push_back(pageNum);
+		modelLeafStarts.push_back(position);
+		for(int i = 0; i < keyCount; i++, position++) {
+			if(pointKeys.empty() || leaf->keyArray[i] != pointKeys.back()) {
+				pointKeys.push_back(leaf->keyArray[i]);
+				pointPositions.push_back(position);
+			}
+		}
+
+		PageId nextPage = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		if(nextPage == Page::INVALID_NUMBER) break;
+		pageNum = nextPage;
+		bufMgr->readPage(file, pageNum, page);
+	}
+	modelEntries = position;
+
+	// a segment grows while some slope keeps every one of its points within LEARNEDERRORWINDOW
+	std::size_t i = 0;
+	while(i < pointKeys.size())
+	{
+		LearnedSegment segment;
+		segment.firstKey = pointKeys[i];
+		segment.startPos = pointPositions[i];
+		double slopeLow = 0;
+		double slopeHigh = std::numeric_limits<double>::max();
+
+		std::size_t j = i + 1;
+		for(; j < pointKeys.size(); j++) {
+			double distance = static_cast<double>(pointKeys[j]) - segment.firstKey;
+			double low = (pointPositions[j] - LEARNEDERRORWINDOW - segment.startPos) / distance;
+			double high = (pointPositions[j] + LEARNEDERRORWINDOW - segment.startPos) / distance;
+			if(std::max(slopeLow, low) > std::min(slopeHigh, high)) break;
+			slopeLow = std::max(slopeLow, low);
+			slopeHigh = std::min(slopeHigh, high);
+		}
+
+		segment.slope = j == i + 1 ? 0 : (slopeLow + slopeHigh) / 2;
+		modelSegments.push_back(segment);
+		i = j;
+	}
+
+	// an empty index has no keys to predict, so it keeps descending
+	modelValid = !modelSegments.empty();
+	writeModel();
+}
+
+void BTreeIndex::writeModel()
+{
+	std::vector<char> bytes;
+	const char *segments = reinterpret_cast<const char*>(modelSegments.data());
+	const char *leafPages = reinterpret_cast<const char*>(modelLeafPages.data());
+	const char *leafStarts = reinterpret_cast<const char*>(modelLeafStarts.data());
+	bytes.insert(bytes.end(), segments, segments + modelSegments.size() * sizeof(LearnedSegment));
+	bytes.insert(bytes.end(), leafPages, leafPages + modelLeafPages.size() * sizeof(PageId));
+	bytes.insert(bytes.end(), leafStarts, leafStarts + modelLeafStarts.size() * sizeof(int));
+	int pageCount = static_cast<int>((bytes.size() + Page::SIZE - 1) / Page::SIZE);
+
+	// a model that outgrew its pages moves to a new run; the old pages are left unused like emptied leaves
+	if(pageCount > modelPageCount) {
+		modelPageNum = file->reservePages(pageCount);
+		modelPageCount = pageCount;
+	}
+
+	for(int i = 0; i < pageCount; i++) {
+		std::size_t first = static_cast<std::size_t>(i) * Page::SIZE;
+		std::size_t count = std::min(static_cast<std::size_t>(Page::SIZE), bytes.size() - first);
+
+		Page *modelPage;
+		bufMgr->readPage(file, modelPageNum + i, modelPage);
+		char *data = reinterpret_cast<char*>(modelPage);
+		memset(data, 0, Page::SIZE);
+		memcpy(data, &bytes[first], count);
+		bufMgr->unPinPage(file, modelPageNum + i, true);
+	}
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo*>(metaPage);
+	metaInfo->modelPageNo = modelPageNum;
+	metaInfo->modelPageCount = modelPageCount;
+	metaInfo->modelSegmentCount = static_cast<int>(modelSegments.size());
+	metaInfo->modelLeafCount = static_cast<int>(modelLeafPages.size());
+	metaInfo->modelEntryCount = modelEntries;
+	metaInfo->modelValid = modelValid ? 1 : 0;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+void BTreeIndex::invalidateModel()
+{
+	modelValid = false;
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	reinterpret_cast<IndexMetaInfo*>(metaPage)->modelValid = 0;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+bool BTreeIndex::modelSeek(int key, bool inclusive, PageId & pageNum, Page *& page)
+{
+	if(modelSegments.empty()) return false;
+
+	// the segment with the last firstKey at or below the key
+	std::size_t low = 0;
+	std::size_t high = modelSegments.size();
+	while(high - low > 1) {
+		std::size_t middle = (low + high) / 2;
+		if(modelSegments[middle].firstKey <= key) low = middle;
+		else high = middle;
+	}
+	const LearnedSegment& segment = modelSegments[low];
+
+	double predicted = segment.startPos + segment.slope * (static_cast<double>(key) - segment.firstKey) - LEARNEDERRORWINDOW;
+	int windowLow = predicted <= 0 ? 0 : (predicted >= modelEntries - 1 ? modelEntries - 1 : static_cast<int>(predicted));
+	int windowHigh = std::min(modelEntries, windowLow + 2 * LEARNEDERRORWINDOW + 1);
+
+	// the leaf holding the low end of the window
+	std::size_t leafIndex = std::upper_bound(modelLeafStarts.begin(), modelLeafStarts.end(), windowLow) - modelLeafStarts.begin() - 1;
+	int leafStart = modelLeafStarts[leafIndex];
+	pageNum = modelLeafPages[leafIndex];
+	bufMgr->readPage(file, pageNum, page);
+	LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+	int leafEnd = leafStart + getLeafOccupancy(leaf);
+
+	// no entry left of the leaf may qualify, and the first one that does shouldn't lie past the window
+	bool confirmed = leafIndex == 0 || !keyQualifies(leaf->keyArray[0], key, inclusive);
+	if(confirmed && windowHigh <= leafEnd && windowHigh < modelEntries &&
+			!keyQualifies(leaf->keyArray[windowHigh - 1 - leafStart], key, inclusive)) {
+		confirmed = false;
+	}
+
+	if(!confirmed) {
+		bufMgr->unPinPage(file, pageNum, false);
+		searchStats.modelFallbacks++;
+		return false;
+	}
+	searchStats.modelSeeks++;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::reorganize
+// -----------------------------------------------------------------------------
+
+double BTreeIndex::leafFragmentation()
+{
+	int hops = 0;
+	int jumps = 0;
+	PageId pageNum;
+	Page *page;
+	descendToLeaf(INT_MIN, Operator::GTE, pageNum, page);
+
+	while(true)
+	{
+		PageId nextPage = reinterpret_cast<LeafNodeInt*>(page)->rightSibPageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		if(nextPage == Page::INVALID_NUMBER) break;
+
+		hops++;
+		if(nextPage != pageNum + 1) jumps++;
+		pageNum = nextPage;
+		bufMgr->readPage(file, pageNum, page);
+	}
+	return hops == 0 ? 0 : static_cast<double>(jumps) / hops;
+}
+
+void BTreeIndex::reorganize()
+{
+	flushMessages();
+
+	std::vector<int> keys;
+	std::vector<RecordId> rids;
+	PageId pageNum;
+	Page *page;
+	descendToLeaf(INT_MIN, Operator::GTE, pageNum, page);
+	while(true)
+	{
+		LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+		int keyCount = getLeafOccupancy(leaf);
+		keys.insert(keys.end(), leaf->keyArray, leaf->keyArray + keyCount);
+		rids.insert(rids.end(), leaf->ridArray, leaf->ridArray + keyCount);
+
+		// the old leaves leave the tree, so positions saved in them must not be resumed
+		PageId nextPage = leaf->rightSibPageNo;
+		leaf->version++;
+		bufMgr->unPinPage(file, pageNum, true);
+		if(nextPage == Page::INVALID_NUMBER) break;
+		pageNum = nextPage;
+		bufMgr->readPage(file, pageNum, page);
+	}
+	if(modelValid) {
+		invalidateModel();
+	}
+
+	// the entries are in memory now, so every old node can be handed out again
+	freeTreePages();
+	bulkLoad(keys, rids);
+}
+
+void BTreeIndex::freeTreePages()
+{
+	std::vector<PageId> level(1, rootPageNum);
+	bool isLeaf = rootPageNum == initialRootPageNum;
+	while(!isLeaf)
+	{
+		std::vector<PageId> children;
+		for(std::size_t i = 0; i < level.size(); i++) {
+			Page *page;
+			bufMgr->readPage(file, level[i], page);
+			NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+			int childCount = getNonLeafOccupancy(node) + 1;
+			children.insert(children.end(), node->pageNoArray, node->pageNoArray + childCount);
+			isLeaf = node->level == 1;
+			bufMgr->unPinPage(file, level[i], false);
+			freeNonLeafPages.insert(level[i]);
+		}
+		level.swap(children);
+	}
+
+	// the first root stays reserved for a tree that fits in one leaf
+	for(std::size_t i = 0; i < level.size(); i++) {
+		if(level[i] != initialRootPageNum) {
+			freeLeafPages.insert(level[i]);
+		}
+	}
+	freePagesDirty = true;
+}
+
+void BTreeIndex::allocNodePage(bool leaf, PageId & pageNum, Page *& page)
+{
+	std::set<PageId> & freePages = leaf ? freeLeafPages : freeNonLeafPages;
+	if(freePages.empty()) {
+		bufMgr->allocPage(file, pageNum, page, leaf ? LEAFEXTENT : NONLEAFEXTENT);
+		memset(reinterpret_cast<char*>(page), 0, Page::SIZE);
+		return;
+	}
+
+	pageNum = *freePages.begin();
+	freePages.erase(freePages.begin());
+	freePagesDirty = true;
+	bufMgr->readPage(file, pageNum, page);
+	std::uint32_t version = leaf ? reinterpret_cast<LeafNodeInt*>(page)->version : 0;
+	memset(reinterpret_cast<char*>(page), 0, Page::SIZE);
+	if(leaf) {
+		reinterpret_cast<LeafNodeInt*>(page)->version = version + 1;
+	}
+}
+
+void BTreeIndex::writeFreePages()
+{
+	PageId next = Page::INVALID_NUMBER;
+	const std::set<PageId> *sets[] = { &freeNonLeafPages, &freeLeafPages };
+	for(int kind = 0; kind < 2; kind++) {
+		for(std::set<PageId>::const_iterator it = sets[kind]->begin(); it != sets[kind]->end(); ++it) {
+			Page *page;
+			bufMgr->readPage(file, *it, page);
+			FreeNodePage *freePage = reinterpret_cast<FreeNodePage*>(page);
+			freePage->nextFreePageNo = next;
+			freePage->leaf = kind;
+			bufMgr->unPinPage(file, *it, true);
+			next = *it;
+		}
+	}
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	reinterpret_cast<IndexMetaInfo*>(metaPage)->freePageNo = next;
+	bufMgr->unPinPage(file, headerPageNum, true);
+	freePagesDirty = false;
+}
+
+void BTreeIndex::readFreePages(PageId pageNum)
+{
+	while(pageNum != Page::INVALID_NUMBER)
+	{
+		Page *page;
+		bufMgr->readPage(file, pageNum, page);
+		FreeNodePage *freePage = reinterpret_cast<FreeNodePage*>(page);
+		(freePage->leaf ? freeLeafPages : freeNonLeafPages).insert(pageNum);
+		PageId next = freePage->nextFreePageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		pageNum = next;
+	}
+}
+
+void BTreeIndex::bulkLoad(const std::vector<int> & keys, const std::vector<RecordId> & rids)
+{
+	PageId pageNum;
+	Page *page;
+	int entryCount = static_cast<int>(keys.size());
+	if(entryCount <= leafOccupancy) {
+		// a single leaf goes back to being the first root
+		bufMgr->readPage(file, initialRootPageNum, page);
+		LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+		std::uint32_t version = leaf->version;
+		memset(leaf, 0, Page::SIZE);
+		leaf->version = version + 1;
+		std::copy(keys.begin(), keys.end(), leaf->keyArray);
+		std::copy(rids.begin(), rids.end(), leaf->ridArray);
+		bufMgr->unPinPage(file, initialRootPageNum, true);
+		rootPageNum = initialRootPageNum;
+		height = 1;
+	}
+	else {
+		// the leaves go into one run of consecutive pages, each one linked to the next, freed ones if possible
+		int leafCount = (entryCount + leafOccupancy - 1) / leafOccupancy;
+		PageId firstLeaf = Page::INVALID_NUMBER;
+		PageId runStart = Page::INVALID_NUMBER;
+		PageId previous = Page::INVALID_NUMBER;
+		for(std::set<PageId>::const_iterator it = freeLeafPages.begin(); it != freeLeafPages.end(); ++it) {
+			if(previous == Page::INVALID_NUMBER || *it != previous + 1) runStart = *it;
+			previous = *it;
+			if(static_cast<int>(*it - runStart) + 1 == leafCount) {
+				firstLeaf = runStart;
+				break;
+			}
+		}
+		if(firstLeaf == Page::INVALID_NUMBER) {
+			firstLeaf = file->reservePages(leafCount);
+		}
+		else {
+			freeLeafPages.erase(freeLeafPages.find(firstLeaf), freeLeafPages.upper_bound(firstLeaf + leafCount - 1));
+			freePagesDirty = true;
+		}
+		std::vector<PageId> children;
+		std::vector<int> childKeys;
+		for(int l = 0; l < leafCount; l++) {
+			int first = l * leafOccupancy;
+			int count = std::min(leafOccupancy, entryCount - first);
+			pageNum = firstLeaf + l;
+			bufMgr->readPage(file, pageNum, page);
+			LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+			std::uint32_t version = leaf->version;
+			memset(leaf, 0, Page::SIZE);
+			leaf->version = version + 1;
+			std::copy(keys.begin() + first, keys.begin() + first + count, leaf->keyArray);
+			std::copy(rids.begin() + first, rids.begin() + first + count, leaf->ridArray);
+			leaf->rightSibPageNo = l + 1 < leafCount ? pageNum + 1 : Page::INVALID_NUMBER;
+			bufMgr->unPinPage(file, pageNum, true);
+
+			children.push_back(pageNum);
+			childKeys.push_back(keys[first]);
+		}
+
+		// every level splits its children evenly among as few nodes as possible, up to a single root
+		int level = 1;
+		height = 1;
+		while(children.size() > 1)
+		{
+			std::vector<PageId> parents;
+			std::vector<int> parentKeys;
+			std::size_t groups = (children.size() + nodeOccupancy) / (nodeOccupancy + 1);
+			for(std::size_t g = 0; g < groups; g++) {
+				std::size_t first = children.size() * g / groups;
+				std::size_t end = children.size() * (g + 1) / groups;
+
+				allocNodePage(false, pageNum, page);
+				NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+				node->level = level;
+				for(std::size_t i = first; i < end; i++) {
+					node->pageNoArray[i - first] = children[i];
+					if(i > first) node->keyArray[i - first - 1] = childKeys[i];
+				}
+				bufMgr->unPinPage(file, pageNum, true);
+				parents.push_back(pageNum);
+				parentKeys.push_back(childKeys[first]);
+			}
+			children.swap(parents);
+			childKeys.swap(parentKeys);
+			level = 0;
+			height++;
+		}
+		rootPageNum = children[0];
+	}
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo*>(metaPage);
+	metaInfo->rootPageNo = rootPageNum;
+	metaInfo->height = height;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::buildIndexes
+// -----------------------------------------------------------------------------
+
+/**
+ * Orders build entries by key only, so that a stable sort keeps equal keys in relation order like inserts do.
+ */
+static bool entryKeyLess(const RIDKeyPair<int> & e1, const RIDKeyPair<int> & e2)
+{
+	return e1.key < e2.key;
+}
+
+void BTreeIndex::buildIndexes(const std::vector<BTreeIndex*> & indexes)
+{
+	// indexes opened from an up to date file need no build
+	std::vector<BTreeIndex*> building;
+	for(std::size_t i = 0; i < indexes.size(); i++) {
+		if(indexes[i]->isBuilding()) building.push_back(indexes[i]);
+	}
+	if(building.empty()) return;
+
+	// one scan of the relation extracts the entries of every index
+	std::vector< std::vector< RIDKeyPair<int> > > entries(building.size());
+	{
+		FileScan scan(building[0]->relationName, building[0]->bufMgr);
+		try {
+			RecordId rid;
+			while(true) {
+				scan.scanNext(rid);
+				std::string recordStr = scan.getRecord();
+				const char *record = recordStr.c_str();
+				for(std::size_t i = 0; i < building.size(); i++) {
+					if(!building[i]->coversRecord(record)) continue;
+
+					RIDKeyPair<int> entry;
+					entry.set(rid, *reinterpret_cast<const int*>(record + building[i]->attrByteOffset));
+					entries[i].push_back(entry);
+				}
+			}
+		}
+		catch(EndOfFileException const&) {
+		}
+	}
+
+	// the sorts don't touch the buffer manager, so each index sorts on its own thread
+	std::vector<std::thread> sorters;
+	for(std::size_t i = 0; i < building.size(); i++) {
+		std::vector< RIDKeyPair<int> > *indexEntries = &entries[i];
+		sorters.push_back(std::thread([indexEntries]() {
+			std::stable_sort(indexEntries->begin(), indexEntries->end(), entryKeyLess);
+		}));
+	}
+	for(std::size_t i = 0; i < sorters.size(); i++) {
+		sorters[i].join();
+	}
+
+	for(std::size_t i = 0; i < building.size(); i++) {
+		BTreeIndex *index = building[i];
+		std::vector<int> keys(entries[i].size());
+		std::vector<RecordId> rids(entries[i].size());
+		for(std::size_t j = 0; j < entries[i].size(); j++) {
+			keys[j] = entries[i][j].key;
+			rids[j] = entries[i][j].rid;
+		}
+		std::vector< RIDKeyPair<int> >().swap(entries[i]);
+
+		// the scan the constructor opened for buildStep() is never read
+		delete index->buildScan;
+		index->buildScan = NULL;
+		index->buildingIndex = false;
+		index->bulkLoad(keys, rids);
+		std::cout << "Single pass build of " << index->file->filename() << " finished." << std::endl;
+
+		index->collectStats(keys);
+		if(index->useBloomFilter) {
+			index->buildBloomFilter(keys);
+		}
+		index->syncRelationMarker();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::exportSnapshot
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::exportSnapshot(const std::string & snapshotName)
+{
+	// the snapshot holds what the leaves hold
+	flushMessages();
+
+	std::ofstream out(snapshotName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!out) throw FileWriteException(snapshotName);
+	std::vector<char> headerPage(Page::SIZE, 0);
+	out.write(&headerPage[0], Page::SIZE);
+
+	// leaves are written as soon as they are full; only their first keys are kept for the inner level
+	std::vector<int> leafKeys;
+	SnapshotLeafInt snapshotLeaf;
+	memset(&snapshotLeaf, 0, sizeof(snapshotLeaf));
+	std::vector<char> padding(Page::SIZE - sizeof(SnapshotLeafInt), 0);
+	int entryCount = 0;
+
+	PageId pageNum;
+	Page *page;
+	descendToLeaf(INT_MIN, Operator::GTE, pageNum, page);
+	while(true)
+	{
+		LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+		int keyCount = getLeafOccupancy(leaf);
+		for(int i = 0; i < keyCount; i++, entryCount++) {
+			int slot = entryCount % SNAPSHOTLEAFSIZE;
+			if(slot == 0) leafKeys.push_back(leaf->keyArray[i]);
+			snapshotLeaf.keyArray[slot] = leaf->keyArray[i];
+			snapshotLeaf.ridArray[slot] = leaf->ridArray[i];
+			if(slot == SNAPSHOTLEAFSIZE - 1) {
+				out.write(reinterpret_cast<const char*>(&snapshotLeaf), sizeof(snapshotLeaf));
+				out.write(&padding[0], padding.size());
+				memset(&snapshotLeaf, 0, sizeof(snapshotLeaf));
+			}
+		}
+
+		PageId nextPage = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		if(nextPage == Page::INVALID_NUMBER) break;
+		pageNum = nextPage;
+		bufMgr->readPage(file, pageNum, page);
+	}
+	if(entryCount % SNAPSHOTLEAFSIZE != 0) {
+		out.write(reinterpret_cast<const char*>(&snapshotLeaf), sizeof(snapshotLeaf));
+		out.write(&padding[0], padding.size());
+	}
+	if(!leafKeys.empty()) {
+		out.write(reinterpret_cast<const char*>(&leafKeys[0]), leafKeys.size() * sizeof(int));
+	}
+
+	SnapshotHeader *header = reinterpret_cast<SnapshotHeader*>(&headerPage[0]);
+	memcpy(header->magic, SNAPSHOTMAGIC, sizeof(SNAPSHOTMAGIC));
+	strncpy(header->relationName, relationName.c_str(), sizeof(header->relationName) - 1);
+	header->attrByteOffset = attrByteOffset;
+	header->attrType = attributeType;
+	header->entryCount = entryCount;
+	header->leafCount = static_cast<int>(leafKeys.size());
+	out.seekp(0, std::ios::beg);
+	out.write(&headerPage[0], Page::SIZE);
+	out.close();
+
+	// a truncated snapshot would only be rejected later, by IndexSnapshot on a replica
+	if(!out) {
+		std::remove(snapshotName.c_str());
+		throw FileWriteException(snapshotName);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::parallelScan
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::parallelScan(const void* lowValParm, const Operator lowOpParm,
+		const void* highValParm, const Operator highOpParm,
+		const int workerCount, std::vector< std::vector<RecordId> > & outRids, const IndexPredicate *queryPredicate)
+{
+	if(lowOpParm != Operator::GT && lowOpParm != Operator::GTE) throw BadOpcodesException();
+	if(highOpParm != Operator::LT && highOpParm != Operator::LTE) throw BadOpcodesException();
+	if(!coversRange(lowValParm, lowOpParm, highValParm, highOpParm) && !coversQuery(queryPredicate)) {
+		throw BadScanParamException();
+	}
+
+	int low = *reinterpret_cast<const int*>(lowValParm);
+	int high = *reinterpret_cast<const int*>(highValParm);
+	if(low > high) throw BadScanrangeException();
+	outRids.clear();
+
+	// workers split the range by key, so the bounds become inclusive
+	if(lowOpParm == Operator::GT) {
+		if(low == INT_MAX) return;
+		low++;
+	}
+	if(highOpParm == Operator::LT) {
+		if(high == INT_MIN) return;
+		high--;
+	}
+	if(low > high) return;
+
+	// the leaves have to hold every entry
+	if(bufferedNodes) {
+		flushMessages();
+	}
+
+	std::vector<int> separators = partitionRange(low, high, workerCount);
+	std::size_t parts = separators.size() + 1;
+	outRids.resize(parts);
+
+	std::mutex bufMgrMutex;
+	std::vector<std::exception_ptr> errors(parts);
+	std::vector<std::thread> workers;
+	for(std::size_t i = 0; i < parts; i++)
+	{
+		int partLow = i == 0 ? low : separators[i - 1];
+		int partHigh = i + 1 == parts ? high : separators[i] - 1;
+		std::vector<RecordId> & partRids = outRids[i];
+		std::exception_ptr & error = errors[i];
+		workers.push_back(std::thread([this, partLow, partHigh, &partRids, &bufMgrMutex, &error]() {
+			try {
+				scanPartition(partLow, partHigh, partRids, bufMgrMutex);
+			}
+			catch(...) {
+				error = std::current_exception();
+			}
+		}));
+	}
+
+	for(std::size_t i = 0; i < parts; i++)
+	{
+		workers[i].join();
+	}
+	for(std::size_t i = 0; i < parts; i++)
+	{
+		if(errors[i]) std::rethrow_exception(errors[i]);
+	}
+}
+
+void BTreeIndex::parallelScan(const void* lowValParm, const Operator lowOpParm,
+		const void* highValParm, const Operator highOpParm,
+		const int workerCount, std::vector<RecordId> & outRids, const IndexPredicate *queryPredicate)
+{
+	std::vector< std::vector<RecordId> > partRids;
+	parallelScan(lowValParm, lowOpParm, highValParm, highOpParm, workerCount, partRids, queryPredicate);
+
+	outRids.clear();
+	for(std::size_t i = 0; i < partRids.size(); i++)
+	{
+		outRids.insert(outRids.end(), partRids[i].begin(), partRids[i].end());
+	}
+}
+
+std::vector<int> BTreeIndex::partitionRange(int low, int high, int parts)
+{
+	std::vector<int> separators;
+	if(parts <= 1 || rootPageNum == initialRootPageNum) return separators;
+
+	// go down a level at a time, only into the children that overlap the range, until there are enough separators
+	std::vector<PageId> nodes(1, rootPageNum);
+	while(true)
+	{
+		separators.clear();
+		std::vector<PageId> children;
+		bool lastLevel = false;
+		for(std::size_t i = 0; i < nodes.size(); i++)
+		{
+			Page *page;
+			bufMgr->readPage(file, nodes[i], page);
+			NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+			int keyCount = getNonLeafOccupancy(node);
+			for(int j = 0; j <= keyCount; j++)
+			{
+				// child j holds the keys from separator j - 1 up to separator j
+				bool overlaps = (j == 0 || node->keyArray[j - 1] <= high) && (j == keyCount || node->keyArray[j] >= low);
+				if(overlaps) children.push_back(node->pageNoArray[j]);
+				if(j < keyCount && node->keyArray[j] > low && node->keyArray[j] <= high) {
+					separators.push_back(node->keyArray[j]);
+				}
+			}
+			lastLevel = node->level == 1;
+			bufMgr->unPinPage(file, nodes[i], false);
+		}
+
+		if(lastLevel || static_cast<int>(separators.size()) >= parts - 1) break;
+		nodes.swap(children);
+	}
+
+	// equal separators would make empty sub-ranges
+	separators.erase(std::unique(separators.begin(), separators.end()), separators.end());
+	if(static_cast<int>(separators.size()) > parts - 1) {
+		std::vector<int> chosen;
+		for(int i = 1; i < parts; i++)
+		{
+			chosen.push_back(separators[i * separators.size() / parts]);
+		}
+		chosen.erase(std::unique(chosen.begin(), chosen.end()), chosen.end());
+		separators.swap(chosen);
+	}
+	return separators;
+}
+
+void BTreeIndex::scanPartition(int low, int high, std::vector<RecordId> & outRids, std::mutex & bufMgrMutex)
+{
+	// binary search only: findKeyIndex() updates the search statistics, which the threads share
+	PageId pageNum = rootPageNum;
+	Page *page;
+	bool isLeaf = rootPageNum == initialRootPageNum;
+	{
+		std::lock_guard<std::mutex> lock(bufMgrMutex);
+		bufMgr->readPage(file, pageNum, page);
+	}
+
+	while(!isLeaf)
+	{
+		NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(page);
+		PageId childPageNum = node->pageNoArray[binarySearchKeyIndex(node->keyArray, 0, getNonLeafOccupancy(node), low, true)];
+		isLeaf = node->level == 1;
+
+		std::lock_guard<std::mutex> lock(bufMgrMutex);
+		bufMgr->unPinPage(file, pageNum, false);
+		pageNum = childPageNum;
+		bufMgr->readPage(file, pageNum, page);
+	}
+
+	// a pinned page stays in its frame, so its entries are read without the lock
+	LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(page);
+	int keyIndex = binarySearchKeyIndex(leaf->keyArray, 0, getLeafOccupancy(leaf), low, true);
+	std::vector<int> selection(INTARRAYLEAFSIZE);
+	while(true)
+	{
+		// the selected entries are a run from keyIndex, since the keys are sorted and none is below low
+		int keyCount = getLeafOccupancy(leaf);
+		int selected = selectKeyRange(leaf->keyArray + keyIndex, keyCount - keyIndex, low, GTE, high, LTE, &selection[0]);
+		for(int i = 0; i < selected; i++)
+		{
+			outRids.push_back(leaf->ridArray[keyIndex + selection[i]]);
+		}
+		keyIndex += selected;
+
+		PageId nextPage = keyIndex < keyCount ? Page::INVALID_NUMBER : leaf->rightSibPageNo;
+		std::lock_guard<std::mutex> lock(bufMgrMutex);
+		bufMgr->unPinPage(file, pageNum, false);
+		if(nextPage == Page::INVALID_NUMBER) return;
+
+		pageNum = nextPage;
+		bufMgr->readPage(file, pageNum, page);
+		leaf = reinterpret_cast<LeafNodeInt*>(page);
+		keyIndex = 0;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::lookupBatch
+// -----------------------------------------------------------------------------
+
+/**
+ * Asks the CPU to load the cache line of an address, without waiting for it.
+ */
+static inline void prefetchLine(const void *address)
+{
+#if defined(__GNUC__)
+	__builtin_prefetch(address);
+#else
+	(void) address;
+#endif
+}
+
+void BTreeIndex::prefetchNode(const Page *page, bool isLeaf)
+{
+	// binary searches start in the middle, and the occupancy of a full node is the common case
+	if(isLeaf) {
+		const LeafNodeInt *leaf = reinterpret_cast<const LeafNodeInt*>(page);
+		prefetchLine(&leaf->keyArray[leafOccupancy / 2]);
+		prefetchLine(&leaf->keyArray[leafOccupancy / 4]);
+		prefetchLine(&leaf->keyArray[3 * leafOccupancy / 4]);
+		prefetchLine(&leaf->ridArray[leafOccupancy / 2]);
+	}
+	else {
+		const NonLeafNodeInt *node = reinterpret_cast<const NonLeafNodeInt*>(page);
+		prefetchLine(&node->level);
+		prefetchLine(&node->keyArray[nodeOccupancy / 2]);
+		prefetchLine(&node->keyArray[nodeOccupancy / 4]);
+		prefetchLine(&node->keyArray[3 * nodeOccupancy / 4]);
+		prefetchLine(&node->pageNoArray[nodeOccupancy / 2]);
+	}
+}
+
+void BTreeIndex::lookupBatch(const std::vector<int> & keys, std::vector< std::vector<RecordId> > & outRids,
+		const int groupSize)
+{
+	outRids.assign(keys.size(), std::vector<RecordId>());
+
+	// the leaves have to hold every entry
+	if(bufferedNodes) {
+		flushMessages();
+	}
+
+	std::size_t group = groupSize > 0 ? groupSize : 1;
+	std::vector<PageId> pageNums(group);
+	std::vector<Page*> pages(group);
+	for(std::size_t first = 0; first < keys.size(); first += group)
+	{
+		std::size_t count = std::min(group, keys.size() - first);
+		std::fill(pageNums.begin(), pageNums.begin() + count, rootPageNum);
+		bool isLeaf = rootPageNum == initialRootPageNum;
+
+		// the tree is balanced, so the lookups of a group reach every level together
+		while(true)
+		{
+			for(std::size_t i = 0; i < count; i++)
+			{
+				bufMgr->readPage(file, pageNums[i], pages[i]);
+				prefetchNode(pages[i], isLeaf);
+			}
+			if(isLeaf) break;
+
+			for(std::size_t i = 0; i < count; i++)
+			{
+				NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(pages[i]);
+				int keyIndex = binarySearchKeyIndex(node->keyArray, 0, getNonLeafOccupancy(node), keys[first + i], true);
+				PageId childPageNum = node->pageNoArray[keyIndex];
+				isLeaf = node->level == 1;
+				bufMgr->unPinPage(file, pageNums[i], false);
+				pageNums[i] = childPageNum;
+			}
+		}
+
+		// entries of a key may continue in the right siblings
+		for(std::size_t i = 0; i < count; i++)
+		{
+			int key = keys[first + i];
+			std::vector<RecordId> & rids = outRids[first + i];
+			PageId pageNum = pageNums[i];
+			LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(pages[i]);
+			int keyCount = getLeafOccupancy(leaf);
+			int keyIndex = binarySearchKeyIndex(leaf->keyArray, 0, keyCount, key, true);
+			while(true)
+			{
+				for(; keyIndex < keyCount && leaf->keyArray[keyIndex] == key; keyIndex++)
+				{
+					rids.push_back(leaf->ridArray[keyIndex]);
+				}
+
+				PageId nextPage = keyIndex < keyCount ? Page::INVALID_NUMBER : leaf->rightSibPageNo;
+				bufMgr->unPinPage(file, pageNum, false);
+				if(nextPage == Page::INVALID_NUMBER) break;
+
+				pageNum = nextPage;
+				Page *page;
+				bufMgr->readPage(file, pageNum, page);
+				leaf = reinterpret_cast<LeafNodeInt*>(page);
+				keyCount = getLeafOccupancy(leaf);
+				keyIndex = 0;
+			}
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::estimateRange
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::collectStats(std::vector<int>& keys)
+{
+	std::sort(keys.begin(), keys.end());
+	memset(&statsInfo, 0, sizeof(statsInfo));
+
+	int numKeys = static_cast<int>(keys.size());
+	statsInfo.numEntries = numKeys;
+	if(numKeys > 0) {
+		statsInfo.minKey = keys.front();
+		statsInfo.maxKey = keys.back();
+	}
+
+	// every bucket takes depth entries, extended to the end of a run of equal keys
+	int depth = (numKeys + HISTOGRAMBUCKETS - 1) / HISTOGRAMBUCKETS;
+	int i = 0;
+	while(i < numKeys)
+	{
+		int end = std::min(i + depth, numKeys);
+		while(end < numKeys && keys[end] == keys[end - 1]) {
+			end++;
+		}
+
+		int distinct = 1;
+		for(int j = i + 1; j < end; j++) {
+			if(keys[j] != keys[j - 1]) distinct++;
+		}
+
+		int bucket = statsInfo.numBuckets++;
+		statsInfo.bucketUpperBound[bucket] = keys[end - 1];
+		statsInfo.bucketCount[bucket] = end - i;
+		statsInfo.bucketDistinct[bucket] = distinct;
+		statsInfo.distinctKeys += distinct;
+		i = end;
+	}
+
+	writeStats();
+}
+
+void BTreeIndex::updateStats(int key)
+{
+	// only a key past the recorded bounds is known to be new without a lookup
+	bool newKey = statsInfo.numEntries == 0 || key < statsInfo.minKey || key > statsInfo.maxKey;
+	if(statsInfo.numEntries == 0 || key < statsInfo.minKey) statsInfo.minKey = key;
+	if(statsInfo.numEntries == 0 || key > statsInfo.maxKey) statsInfo.maxKey = key;
+	statsInfo.numEntries++;
+
+	if(statsInfo.numBuckets == 0) {
+		statsInfo.numBuckets = 1;
+		statsInfo.bucketUpperBound[0] = key;
+	}
+
+	// keys past the last bucket widen it
+	int bucket = binarySearchKeyIndex(statsInfo.bucketUpperBound, 0, statsInfo.numBuckets, key, true);
+	if(bucket == statsInfo.numBuckets) {
+		bucket--;
+		statsInfo.bucketUpperBound[bucket] = key;
+	}
+	statsInfo.bucketCount[bucket]++;
+	if(newKey) {
+		statsInfo.bucketDistinct[bucket]++;
+		statsInfo.distinctKeys++;
+	}
+}
+
+void BTreeIndex::removeStats(int key)
+{
+	if(statsInfo.numEntries > 0) statsInfo.numEntries--;
+
+	// the last entry is gone, so nothing recorded about the keys holds any more
+	if(statsInfo.numEntries == 0) {
+		memset(&statsInfo, 0, sizeof(statsInfo));
+		return;
+	}
+
+	int bucket = binarySearchKeyIndex(statsInfo.bucketUpperBound, 0, statsInfo.numBuckets, key, true);
+	if(bucket < statsInfo.numBuckets && statsInfo.bucketCount[bucket] > 0) {
+		statsInfo.bucketCount[bucket]--;
+	}
+}
+
+void BTreeIndex::writeStats()
+{
+	Page *statsPage;
+	if(statsPageNum == Page::INVALID_NUMBER) {
+		// the histogram is kept with the non-leaf pages, out of the runs of leaves
+		bufMgr->allocPage(file, statsPageNum, statsPage, NONLEAFEXTENT);
+
+		Page *metaPage;
+		bufMgr->readPage(file, headerPageNum, metaPage);
+		reinterpret_cast<IndexMetaInfo*>(metaPage)->statsPageNo = statsPageNum;
+		bufMgr->unPinPage(file, headerPageNum, true);
+	}
+	else {
+		bufMgr->readPage(file, statsPageNum, statsPage);
+	}
+
+	*reinterpret_cast<IndexStatsInfo*>(statsPage) = statsInfo;
+	bufMgr->unPinPage(file, statsPageNum, true);
+}
+
+double BTreeIndex::estimateRange(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	if(lowOpParm != Operator::GT && lowOpParm != Operator::GTE) throw BadOpcodesException();
+	if(highOpParm != Operator::LT && highOpParm != Operator::LTE) throw BadOpcodesException();
+	if(*reinterpret_cast<const int*>(lowValParm) > *reinterpret_cast<const int*>(highValParm)) throw BadScanrangeException();
+
+	// turn the bounds into an inclusive range of integer keys
+	std::int64_t low = *reinterpret_cast<const int*>(lowValParm);
+	std::int64_t high = *reinterpret_cast<const int*>(highValParm);
+	if(lowOpParm == Operator::GT) low++;
+	if(highOpParm == Operator::LT) high--;
+	if(low > high) return 0;
+
+	double estimate = 0;
+	std::int64_t bucketLow = statsInfo.minKey;
+	for(int bucket = 0; bucket < statsInfo.numBuckets; bucket++)
+	{
+		std::int64_t bucketHigh = statsInfo.bucketUpperBound[bucket];
+		std::int64_t overlapLow = std::max(low, bucketLow);
+		std::int64_t overlapHigh = std::min(high, bucketHigh);
+
+		if(overlapLow <= overlapHigh) {
+			if(low == high)
+				estimate += static_cast<double>(statsInfo.bucketCount[bucket]) / statsInfo.bucketDistinct[bucket];
+			else
+				estimate += static_cast<double>(statsInfo.bucketCount[bucket]) * (overlapHigh - overlapLow + 1) / (bucketHigh - bucketLow + 1);
+		}
+		bucketLow = bucketHigh + 1;
+	}
+	return estimate;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::startScan
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm,
+				   std::size_t limit,
+				   const IndexPredicate *queryPredicate)
+{
+	/*
+	This method is used to begin a “filtered scan” of the index. For example, if the
+	method is called using arguments (1,GT,100,LTE), then the scan should seek all
+	entries greater than 1 and less than or equal to 100.
+	*/
+
+	ScanRange range = { lowValParm, lowOpParm, highValParm, highOpParm };
+	startScan(std::vector<ScanRange>(1, range), NULL, limit, queryPredicate);
+}
+
+void BTreeIndex::startScan(const std::vector<ScanRange>& ranges, const ScanRange* keyFilter, std::size_t limit,
+		const IndexPredicate *queryPredicate)
+{
+	KeyRange<int> filter;
+	if(keyFilter != NULL) {
+		if(keyFilter->lowOp != Operator::GT && keyFilter->lowOp != Operator::GTE) throw BadOpcodesException();
+		if(keyFilter->highOp != Operator::LT && keyFilter->highOp != Operator::LTE) throw BadOpcodesException();
+		filter.set(*reinterpret_cast<const int*>(keyFilter->lowVal), keyFilter->lowOp,
+				*reinterpret_cast<const int*>(keyFilter->highVal), keyFilter->highOp);
+		if(filter.lowVal > filter.highVal) throw BadScanrangeException();
+	}
+
+	std::vector< KeyRange<int> > intRanges;
+	for(std::size_t i = 0; i < ranges.size(); i++)
+	{
+		const ScanRange& range = ranges[i];
+		if(range.lowOp != Operator::GT && range.lowOp != Operator::GTE) throw BadOpcodesException();
+		if(range.highOp != Operator::LT && range.highOp != Operator::LTE) throw BadOpcodesException();
+
+		// a partial index would only return the part of an uncovered range that satisfies its predicate
+		if(!coversRange(range.lowVal, range.lowOp, range.highVal, range.highOp) && !coversQuery(queryPredicate)) {
+			throw BadScanParamException();
+		}
+
+		KeyRange<int> intRange;
+		intRange.set(*reinterpret_cast<const int*>(range.lowVal), range.lowOp,
+				*reinterpret_cast<const int*>(range.highVal), range.highOp);
+		if(intRange.lowVal > intRange.highVal) throw BadScanrangeException();
+
+		// each range has to start after the previous one ends
+		if(!intRanges.empty()) {
+			const KeyRange<int>& previous = intRanges.back();
+			bool disjoint = intRange.lowVal > previous.highVal ||
+				(intRange.lowVal == previous.highVal && (previous.highOp == Operator::LT || intRange.lowOp == Operator::GT));
+			if(!disjoint) throw BadScanrangeException();
+		}
+		intRanges.push_back(intRange);
+	}
+
+	// point ranges for keys ruled out by the Bloom filter need no descent
+	if(!bloomBlocks.empty()) {
+		std::size_t kept = 0;
+		for(std::size_t i = 0; i < intRanges.size(); i++)
+		{
+			const KeyRange<int>& range = intRanges[i];
+			bool point = range.lowOp == Operator::GTE && range.highOp == Operator::LTE && range.lowVal == range.highVal;
+			if(!point || bloomMayContain(range.lowVal)) {
+				intRanges[kept++] = range;
+			}
+		}
+		intRanges.resize(kept);
+	}
+
+	// only one scan at a time
+	if(scanExecuting) {
+		endScan();
+	}
+
+	scanRanges.swap(intRanges);
+	currentRange = 0;
+	currentPageData = NULL;
+	scanInserts.clear();
+	scanMessages.clear();
+	nextInsert = 0;
+	scanFiltered = keyFilter != NULL;
+	scanFilter = filter;
+	entryReturned = false;
+	scanLimit = limit;
+	scanReturned = 0;
+
+	if(scanRanges.empty()) throw NoSuchKeyFoundException();
+	if(bufferedNodes) {
+		prepareBufferedScan();
+	}
+
+	// buffered inserts are filtered up front, so that they merge with the selected leaf entries in key order
+	if(scanFiltered && !scanInserts.empty()) {
+		std::vector<int> keys(scanInserts.size());
+		for(std::size_t i = 0; i < scanInserts.size(); i++) {
+			keys[i] = scanInserts[i].key;
+		}
+		std::vector<int> selection(keys.size());
+		int selected = selectKeyRange(&keys[0], static_cast<int>(keys.size()), scanFilter.lowVal, scanFilter.lowOp,
+				scanFilter.highVal, scanFilter.highOp, &selection[0]);
+		for(int i = 0; i < selected; i++) {
+			scanInserts[i] = scanInserts[selection[i]];
+		}
+		scanInserts.resize(selected);
+	}
+
+	// Sets data in the provided parameters for scanNext()
+	lowValInt	= scanRanges[0].lowVal;
+	highValInt	= scanRanges[0].highVal;
+	lowOp 		= scanRanges[0].lowOp;
+	highOp		= scanRanges[0].highOp;
+
+	if(!seekRange() && !nextRange()) {
+		// nothing satisifies the scan
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageData = NULL;
+		if(scanInserts.empty()) throw NoSuchKeyFoundException();
+
+		// only buffered inserts satisfy the scan
+		nextEntry = -1;
+	}
+
+	scanExecuting = true;
+}
+
+void BTreeIndex::descendToLeaf(int key, Operator lowOpParm, PageId & pageNum, Page *& page)
+{
+	// a model trained on the unmodified leaves skips the non-leaf levels
+	if(modelValid && modelSeek(key, lowOpParm == Operator::GTE, pageNum, page)) {
+		return;
+	}
+
+	// Get the root to start the descent
+	PageId traversalPageId = rootPageNum;
+	Page* p;
+	bufMgr->readPage(file, traversalPageId, p);
+	bool is_leaf = rootPageNum == initialRootPageNum;
+
+	// descend until the leaf that may hold the first matching entry is pinned
+	while(!is_leaf)
+	{
+		NonLeafNodeInt *node = reinterpret_cast<NonLeafNodeInt*>(p);
+		PageId pageId = findLeastPageId(node, key, lowOpParm);
+
+		// if the node is on the last level, then the next level has leaf nodes.
+		is_leaf = node->level == 1;
+		bufMgr->unPinPage(file, traversalPageId, false);
+		traversalPageId = pageId;
+		bufMgr->readPage(file, traversalPageId, p);
+	}
+
+	// this is the pageNum we're looking for
+	pageNum = traversalPageId;
+	page = p;
+}
+
+bool BTreeIndex::seekRange()
+{
+	LeafNodeInt *leaf;
+	int keyCount = 0;
+
+	// stay in the pinned leaf if the range starts at or before its last key
+	if(currentPageData != NULL) {
+		leaf = reinterpret_cast<LeafNodeInt*>(currentPageData);
+		keyCount = getLeafOccupancy(leaf);
+		if(keyCount == 0 || !keyQualifies(leaf->keyArray[keyCount - 1], lowValInt, lowOp == Operator::GTE)) {
+			bufMgr->unPinPage(file, currentPageNum, false);
+			currentPageData = NULL;
+		}
+	}
+
+	if(currentPageData == NULL) {
+		descendToLeaf(lowValInt, lowOp, currentPageNum, currentPageData);
+	}
+
+	// the operators of the range are dispatched once, not compared for every entry
+	rangeEndKernel = rangeEndFor(lowOp, highOp);
+
+	// the first entry satisfying the low bound may be in a right sibling
+	while(true)
+	{
+		leaf = reinterpret_cast<LeafNodeInt*>(currentPageData);
+		keyCount = getLeafOccupancy(leaf);
+		nextEntry = findKeyIndex(leaf->keyArray, keyCount, lowValInt, lowOp == Operator::GTE);
+
+		if(nextEntry < keyCount) {
+			int key = leaf->keyArray[nextEntry];
+			bool inRange = highOp == Operator::LT ? key < highValInt : key <= highValInt;
+			if(!inRange && lowOp == Operator::GTE && highOp == Operator::LTE && lowValInt == highValInt) {
+				recordBloomFalsePositive();
+			}
+
+			if(inRange) {
+				findLeafRangeEnd();
+			}
+			return inRange;
+		}
+
+		if(leaf->rightSibPageNo == Page::INVALID_NUMBER) {
+			if(lowOp == Operator::GTE && highOp == Operator::LTE && lowValInt == highValInt) {
+				recordBloomFalsePositive();
+			}
+			return false;
+		}
+
+		PageId nextPage = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageNum = nextPage;
+		bufMgr->readPage(file, currentPageNum, currentPageData);
+	}
+}
+
+bool BTreeIndex::nextRange()
+{
+	while(++currentRange < scanRanges.size())
+	{
+		lowValInt	= scanRanges[currentRange].lowVal;
+		highValInt	= scanRanges[currentRange].highVal;
+		lowOp 		= scanRanges[currentRange].lowOp;
+		highOp		= scanRanges[currentRange].highOp;
+
+		if(seekRange()) return true;
+	}
+	return false;
 }
 
 // -----------------------------------------------------------------------------
 // BTreeIndex::scanNext
 // -----------------------------------------------------------------------------
 
-void BTreeIndex::scanNext(RecordId& outRid) 
+void BTreeIndex::scanNext(RecordId& outRid)
 {
 	/*
 	This method fetches the record id of the next tuple that matches the scan crite-
@@ -391,55 +2599,153 @@ void BTreeIndex::scanNext(RecordId& outRid)
 	successive key values for the scan.
 	*/
 
-	// NOTE: I'm not sure how to "unpin" a page. I assume if there were a funciton that
-	// did that, then you would do it in the second if statement (nextEntry >= leafRidLength).
-	
-	if(nextEntry < 0) throw IndexScanCompletedException();
 	if(!scanExecuting) throw ScanNotInitializedException();
 
-	LeafNodeInt leaf = *reinterpret_cast<LeafNodeInt*>(currentPageData);
-	int leafRidLength = sizeof(leaf.ridArray) / sizeof(leaf.ridArray[0]);
+	// a limited scan is completed once it returned the limit, without looking at another entry
+	if(scanReturned == scanLimit && scanLimit != 0) throw IndexScanCompletedException();
 
-	// if it's out of bounds of the array, move on to the next page, or throw an error
-	if(nextEntry >= leafRidLength) {
-		// I assume that if rightSibPageNo = 0, then it's "null", indicating that there
-		// is no next page. If that is the case, the scan must be done.
-		if(leaf.rightSibPageNo == 0) {
-			throw IndexScanCompletedException();
+	while(nextEntry >= 0)
+	{
+		LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(currentPageData);
+
+		// the entries of the run are in range, passed the filter and the buffered messages, and come before the next
+		// buffered insert, so they are returned without another comparison
+		if(nextRun < runEnd) {
+			int entry = windowSelected ? leafSelection[nextRun] : nextRun;
+			nextRun++;
+			nextEntry = entry + 1;
+			outRid = leaf->ridArray[entry];
+			entryReturned = true;
+			lastKeyReturned = leaf->keyArray[entry];
+			lastRidReturned = outRid;
+			if(++scanReturned == scanLimit) {
+				releaseLimitedScan();
+			}
+			return;
 		}
 
-		// unpins a page when all records from it are read
-		bufMgr->unPinPage(file, currentPageNum, false);
+		// a buffered insert with a smaller key than the rest of the window comes first
+		if(runEnd < windowEnd) break;
+		nextEntry = leafRangeEnd;
 
-		PageId nextPage = leaf.rightSibPageNo;
-		currentPageNum = nextPage;
-		bufMgr->readPage(file, nextPage, currentPageData);
-		nextEntry = 0;
+		// the range goes on past the end of the leaf, move on to the next page, or end the scan
+		if(leafRangeEnd == leafEntryCount) {
+			// rightSibPageNo = 0 indicates that there is no next page, so the scan must be done.
+			if(leaf->rightSibPageNo == Page::INVALID_NUMBER) {
+				nextEntry = -1;
+				break;
+			}
+
+			// unpins a page when all records from it are read
+			PageId nextPage = leaf->rightSibPageNo;
+			bufMgr->unPinPage(file, currentPageNum, false);
+			currentPageNum = nextPage;
+			bufMgr->readPage(file, nextPage, currentPageData);
+			nextEntry = 0;
+			findLeafRangeEnd();
+			continue;
+		}
+
+		// buffered inserts of this range come before the next one
+		if(nextInsert < scanInserts.size() &&
+				(highOp == Operator::LT ? scanInserts[nextInsert].key < highValInt : scanInserts[nextInsert].key <= highValInt)) break;
+
+		// otherwise this range is completed; the page stays pinned until endScan
+		if(!nextRange()) {
+			nextEntry = -1;
+		}
+	}
+
+	// the buffered inserts are merged in key order, the rest follows once the leaves are done
+	if(nextInsert < scanInserts.size()) {
+		outRid.page_number = scanInserts[nextInsert].pageNo;
+		outRid.slot_number = scanInserts[nextInsert].slotNo;
+		entryReturned = true;
+		lastKeyReturned = scanInserts[nextInsert].key;
+		lastRidReturned = outRid;
+		nextInsert++;
+		if(nextEntry >= 0) {
+			findLeafRun();
+		}
+		if(++scanReturned == scanLimit) {
+			releaseLimitedScan();
+		}
+		return;
+	}
+	throw IndexScanCompletedException();
+}
+
+void BTreeIndex::releaseLimitedScan()
+{
+	// the leaf is unpinned right away, and no right sibling is read for entries that won't be returned
+	if(currentPageData != NULL) {
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageData = NULL;
+	}
+	nextEntry = -1;
+	nextInsert = scanInserts.size();
+}
 
-		// I'm getting recursive here. Not sure if I did the & right
-		// The idea is we redo the process now that the next page is set.
-		scanNext(outRid); 
+void BTreeIndex::findLeafRangeEnd()
+{
+	LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(currentPageData);
+	leafEntryCount = getLeafOccupancy(leaf);
+	leafRangeEnd = rangeEndKernel(leaf->keyArray, nextEntry, leafEntryCount, lowValInt, highValInt);
+
+	// without a filter or buffered messages the whole window is returned, otherwise the entries selected in it
+	windowSelected = scanFiltered || !scanMessages.empty();
+	if(!windowSelected) {
+		nextRun = nextEntry;
+		windowEnd = leafRangeEnd;
+		findLeafRun();
 		return;
 	}
 
-	// No need to check for greater than, because that has already happened in the
-	// startScan function. We only need to check lesser than.
-	int key = leaf.keyArray[nextEntry];
-	bool comparison;
-	if(highOp == Operator::LT) 
-		comparison = key < highValInt;
-	else if(highOp == Operator::LTE)
-		comparison = key <= highValInt;
+	leafSelection.resize(INTARRAYLEAFSIZE);
+	if(scanFiltered) {
+		windowEnd = selectKeyRange(leaf->keyArray + nextEntry, leafRangeEnd - nextEntry, scanFilter.lowVal, scanFilter.lowOp,
+				scanFilter.highVal, scanFilter.highOp, &leafSelection[0]);
+		for(int i = 0; i < windowEnd; i++) {
+			leafSelection[i] += nextEntry;
+		}
+	}
+	else {
+		windowEnd = leafRangeEnd - nextEntry;
+		for(int i = 0; i < windowEnd; i++) {
+			leafSelection[i] = nextEntry + i;
+		}
+	}
+
+	// the buffered messages decide whether their entries still exist, so the leaf entries among them are dropped
+	if(!scanMessages.empty()) {
+		int kept = 0;
+		for(int i = 0; i < windowEnd; i++) {
+			int entry = leafSelection[i];
+			IndexMessage message = { leaf->keyArray[entry], leaf->ridArray[entry].page_number, leaf->ridArray[entry].slot_number, 0 };
+			leafSelection[kept] = entry;
+			kept += !std::binary_search(scanMessages.begin(), scanMessages.end(), message, messageLess);
+		}
+		windowEnd = kept;
+	}
+	nextRun = 0;
+	findLeafRun();
+}
 
-	// if the comparison holds true, return it and go to the next entry.
-	// otherwise, our scan is completed.
-	if(comparison) {
-		outRid = leaf.ridArray[nextEntry];
-		nextEntry++;
+void BTreeIndex::findLeafRun()
+{
+	runEnd = windowEnd;
+	if(nextInsert == scanInserts.size()) return;
+
+	// entries with a larger key than the next buffered insert wait until it is returned
+	LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(currentPageData);
+	int slotEnd = static_cast<int>(std::upper_bound(leaf->keyArray + nextEntry, leaf->keyArray + leafRangeEnd,
+			scanInserts[nextInsert].key) - leaf->keyArray);
+	if(windowSelected) {
+		const int *selection = &leafSelection[0];
+		runEnd = static_cast<int>(std::lower_bound(selection + nextRun, selection + windowEnd, slotEnd) - selection);
 	}
 	else {
-		// unpins a page when scan has reached its end
-		throw IndexScanCompletedException();
+		runEnd = slotEnd;
 	}
 }
 
@@ -447,12 +2753,12 @@ void BTreeIndex::scanNext(RecordId& outRid)
 // BTreeIndex::endScan
 // -----------------------------------------------------------------------------
 //
-void BTreeIndex::endScan() 
+void BTreeIndex::endScan()
 {
 	/*
 	This method terminates the current scan and unpins all the pages that have been
 	pinned for the purpose of the scan. It throws ScanNotInitializedException
-	when called before a successful startScan call.  
+	when called before a successful startScan call.
 	*/
 
 	if(!scanExecuting) {
@@ -469,13 +2775,208 @@ void BTreeIndex::endScan()
 	 * 	2) makes the complexity of page pinning easier among the two functions
 	 * 	3) keeps the "end" in the endScan function
 	*/
-	bufMgr->unPinPage(file, currentPageNum, false);
+	if(currentPageData != NULL) {
+		bufMgr->unPinPage(file, currentPageNum, false);
+	}
 
-	// in our current implementation, root is kept pinned until destructor is called
 	// no other pages are kept pinned throughout entirety of scan
-	// bufMgr->unPinPage(file, rootPageNum, false);
-
 	scanExecuting = false;
+	nextEntry = -1;
+	currentPageData = NULL;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::coversRecord
+// -----------------------------------------------------------------------------
+
+/**
+ * Returns true if value satisfies the comparison (op, bound).
+ */
+static bool compareBound(double value, Operator op, double bound)
+{
+	switch(op) {
+		case Operator::LT: return value < bound;
+		case Operator::LTE: return value <= bound;
+		case Operator::GTE: return value >= bound;
+		default: return value > bound;
+	}
+}
+
+/**
+ * Returns true if every value satisfying the comparison (queryOp, queryVal) satisfies (indexOp, indexVal).
+ */
+static bool boundImplies(Operator queryOp, double queryVal, Operator indexOp, double indexVal)
+{
+	bool lower = indexOp == Operator::GT || indexOp == Operator::GTE;
+	if(lower != (queryOp == Operator::GT || queryOp == Operator::GTE)) return false;
+
+	// equal constants only work if the query bound is at least as strict
+	if(queryVal == indexVal) {
+		return queryOp == indexOp || queryOp == Operator::GT || queryOp == Operator::LT;
+	}
+	return lower ? queryVal > indexVal : queryVal < indexVal;
+}
+
+bool BTreeIndex::coversRecord(const char *record) const
+{
+	if(!partial) return true;
+
+	const char *attribute = record + predicate.attrByteOffset;
+	double value = predicate.attrType == INTEGER ?
+		static_cast<double>(*reinterpret_cast<const int*>(attribute)) : *reinterpret_cast<const double*>(attribute);
+	return compareBound(value, predicate.op, predicate.value);
+}
+
+bool BTreeIndex::coversQuery(const IndexPredicate *queryPredicate) const
+{
+	if(!partial) return true;
+	if(queryPredicate == NULL) return false;
+
+	return queryPredicate->attrByteOffset == predicate.attrByteOffset && queryPredicate->attrType == predicate.attrType &&
+		boundImplies(queryPredicate->op, queryPredicate->value, predicate.op, predicate.value);
+}
+
+bool BTreeIndex::coversRange(const void* lowValParm, const Operator lowOpParm, const void* highValParm, const Operator highOpParm) const
+{
+	if(!partial) return true;
+	if(predicate.attrByteOffset != attrByteOffset || predicate.attrType != attributeType) return false;
+
+	// only the bound on the same side as the predicate can imply it
+	bool lower = predicate.op == Operator::GT || predicate.op == Operator::GTE;
+	int bound = *reinterpret_cast<const int*>(lower ? lowValParm : highValParm);
+	return boundImplies(lower ? lowOpParm : highOpParm, bound, predicate.op, predicate.value);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::saveScan
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::saveScan(ScanCursor & cursor)
+{
+	if(!scanExecuting) throw ScanNotInitializedException();
+	if(scanRanges.size() > 1 || scanFiltered) throw BadScanParamException();
+
+	cursor.started = entryReturned;
+	cursor.lastKey = entryReturned ? lastKeyReturned : 0;
+	cursor.lastRid = entryReturned ? lastRidReturned : RecordId();
+	cursor.lowVal = lowValInt;
+	cursor.lowOp = lowOp;
+	cursor.highVal = highValInt;
+	cursor.highOp = highOp;
+
+	// a leaf position doesn't account for merged buffered messages, so such a scan resumes with a descent
+	if(currentPageData != NULL && nextEntry >= 0 && scanInserts.empty() && scanMessages.empty()) {
+		cursor.pageNo = currentPageNum;
+		cursor.slot = nextEntry;
+		cursor.leafVersion = reinterpret_cast<LeafNodeInt*>(currentPageData)->version;
+	}
+	else {
+		cursor.pageNo = Page::INVALID_NUMBER;
+		cursor.slot = -1;
+		cursor.leafVersion = 0;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::resumeScan
+// -----------------------------------------------------------------------------
+
+void BTreeIndex::resumeScan(const ScanCursor & cursor)
+{
+	// a cursor is only resumed if startScan() would accept its range
+	if(cursor.lowOp != Operator::GT && cursor.lowOp != Operator::GTE) throw BadOpcodesException();
+	if(cursor.highOp != Operator::LT && cursor.highOp != Operator::LTE) throw BadOpcodesException();
+	KeyRange<int> range;
+	range.set(cursor.lowVal, cursor.lowOp, cursor.highVal, cursor.highOp);
+	if(range.lowVal > range.highVal) throw BadScanrangeException();
+
+	if(scanExecuting) {
+		endScan();
+	}
+
+	// the leaves have to hold every entry
+	if(bufferedNodes) {
+		flushMessages();
+	}
+
+	// an unchanged leaf still has the next entry at the saved slot; a page that can't be read falls back to a descent
+	Page *cursorPage = NULL;
+	if(cursor.pageNo != Page::INVALID_NUMBER) {
+		try
+		{
+			bufMgr->readPage(file, cursor.pageNo, cursorPage);
+		}
+		catch(const InvalidPageException &e)
+		{
+			cursorPage = NULL;
+		}
+		if(cursorPage != NULL) {
+			LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(cursorPage);
+			if(leaf->version != cursor.leafVersion || cursor.slot < 0 || cursor.slot > getLeafOccupancy(leaf)) {
+				bufMgr->unPinPage(file, cursor.pageNo, false);
+				cursorPage = NULL;
+			}
+		}
+	}
+
+	scanRanges.assign(1, range);
+	currentRange = 0;
+	currentPageData = NULL;
+	scanInserts.clear();
+	scanMessages.clear();
+	nextInsert = 0;
+	scanFiltered = false;
+	scanLimit = 0;
+	scanReturned = 0;
+	entryReturned = cursor.started;
+	lastKeyReturned = cursor.lastKey;
+	lastRidReturned = cursor.lastRid;
+
+	lowValInt	= cursor.lowVal;
+	highValInt	= cursor.highVal;
+	lowOp 		= cursor.lowOp;
+	highOp		= cursor.highOp;
+	rangeEndKernel = rangeEndFor(lowOp, highOp);
+	scanExecuting = true;
+
+	if(cursorPage != NULL) {
+		currentPageNum = cursor.pageNo;
+		currentPageData = cursorPage;
+		nextEntry = cursor.slot;
+		findLeafRangeEnd();
+		return;
+	}
+
+	// otherwise descend to the last key returned, or to the start of the range if none was
+	if(cursor.started) {
+		lowValInt = cursor.lastKey;
+		lowOp = Operator::GTE;
+	}
+	if(!seekRange()) {
+		nextEntry = -1;
+		return;
+	}
+	if(!cursor.started) return;
+
+	// entries with the last key were returned up to the last entry
+	while(true)
+	{
+		LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt*>(currentPageData);
+		int keyCount = getLeafOccupancy(leaf);
+		bool found = false;
+		while(nextEntry < keyCount && leaf->keyArray[nextEntry] == cursor.lastKey && !found) {
+			found = leaf->ridArray[nextEntry] == cursor.lastRid;
+			nextEntry++;
+		}
+		if(found || nextEntry < keyCount || leaf->rightSibPageNo == Page::INVALID_NUMBER) break;
+
+		PageId nextPage = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageNum = nextPage;
+		bufMgr->readPage(file, currentPageNum, currentPageData);
+		nextEntry = 0;
+	}
+	findLeafRangeEnd();
 }
 
 }
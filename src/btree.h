@@ -11,11 +11,16 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <cstdint>
+#include <vector>
+#include <set>
+#include <mutex>
 
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "filescan.h"
 
 namespace badgerdb
 {
@@ -90,6 +95,103 @@ public:
 	}
 };
 
+/**
+ * @brief Structure to store the bounds of one range of a scan, with the same meaning as the parameters
+ * of BTreeIndex::startScan(). Is templated for the key members.
+*/
+template <class T>
+class KeyRange{
+public:
+	T lowVal;
+	Operator lowOp;
+	T highVal;
+	Operator highOp;
+	void set( T l, Operator lo, T h, Operator ho)
+	{
+		lowVal = l;
+		lowOp = lo;
+		highVal = h;
+		highOp = ho;
+	}
+};
+
+/**
+ * @brief One range of a multi-range scan passed to BTreeIndex::startScan(). The values point to
+ * integer / double / char string keys exactly like the parameters of the single range startScan().
+*/
+struct ScanRange{
+	const void* lowVal;
+	Operator lowOp;
+	const void* highVal;
+	Operator highOp;
+};
+
+/**
+ * @brief Predicate of a partial index: a comparison of an INTEGER or DOUBLE attribute of the record with a constant,
+ * e.g. { offsetof(tuple,d), DOUBLE, GT, 0 } for d > 0. Only records that satisfy it are indexed.
+*/
+struct IndexPredicate{
+  /**
+   * Offset of the compared attribute inside records.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the compared attribute, INTEGER or DOUBLE.
+   */
+	Datatype attrType;
+
+  /**
+   * Comparison of the attribute with value.
+   */
+	Operator op;
+
+  /**
+   * Constant the attribute is compared with. An INTEGER attribute is converted to double, which is exact.
+   */
+	double value;
+};
+
+/**
+ * @brief Position of a single range scan saved by BTreeIndex::saveScan() and resumed by BTreeIndex::resumeScan(),
+ * e.g. between the pages of a paginated result. It is plain data, so it can be serialized by copying its bytes.
+*/
+struct ScanCursor{
+  /**
+   * Leaf holding the next entry, Page::INVALID_NUMBER if the scan has to resume with a descent.
+   */
+	PageId pageNo;
+
+  /**
+   * Index of the next entry in that leaf.
+   */
+	int slot;
+
+  /**
+   * Version of the leaf when the position was saved. The position is only used if it is unchanged.
+   */
+	std::uint32_t leafVersion;
+
+  /**
+   * True if the scan returned an entry before it was saved.
+   */
+	bool started;
+
+  /**
+   * Key and record id of the last entry returned, where a descent resumes from.
+   */
+	int lastKey;
+	RecordId lastRid;
+
+  /**
+   * Bounds of the range being scanned.
+   */
+	int lowVal;
+	Operator lowOp;
+	int highVal;
+	Operator highOp;
+};
+
 /**
  * @brief Overloaded operator to compare the key values of two rid-key pairs
  * and if they are the same compares to see if the first pair has
@@ -132,8 +234,175 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
+
+  /**
+   * Page number of the page holding the IndexStatsInfo of the index, 0 if statistics were never collected.
+   */
+	PageId statsPageNo;
+
+  /**
+   * Height of the tree, 1 while the root is still a leaf.
+   */
+	int height;
+
+  /**
+   * Number of pages of the base relation when the index was built from it.
+   */
+	PageId relationPageCount;
+
+  /**
+   * Last modification time, in nanoseconds, of the base relation file when the index was built from it.
+   * Together with relationPageCount this tells whether the relation changed since, in which case the index is rebuilt on open.
+   */
+	std::int64_t relationModTime;
+
+  /**
+   * First of the consecutive pages holding the Bloom filter of the index, 0 if it has none.
+   */
+	PageId bloomPageNo;
+
+  /**
+   * Number of pages allocated to the Bloom filter.
+   */
+	int bloomPageCount;
+
+  /**
+   * Number of BloomBlock in the Bloom filter.
+   */
+	int bloomBlockCount;
+
+  /**
+   * First of the consecutive pages holding the learned model of the leaf level, 0 if the index has none.
+   */
+	PageId modelPageNo;
+
+  /**
+   * Number of pages allocated to the learned model.
+   */
+	int modelPageCount;
+
+  /**
+   * Number of LearnedSegment in the learned model.
+   */
+	int modelSegmentCount;
+
+  /**
+   * Number of leaves the learned model was trained on.
+   */
+	int modelLeafCount;
+
+  /**
+   * Number of entries the learned model was trained on.
+   */
+	int modelEntryCount;
+
+  /**
+   * 1 if the index wasn't modified since the learned model was trained, 0 otherwise.
+   */
+	int modelValid;
+
+  /**
+   * 1 if the non-leaf nodes of the index keep message buffers, 0 otherwise.
+   */
+	int bufferedNodes;
+
+  /**
+   * 1 if the index is partial, holding only the records that satisfy predicate, 0 otherwise.
+   */
+	int partial;
+
+  /**
+   * Predicate of a partial index.
+   */
+	IndexPredicate predicate;
+
+  /**
+   * Runs of pages the extents of the file were handing out when the index was closed, restored when it is opened.
+   */
+	File::Extent extents[BlobFile::EXTENT_COUNT];
+
+  /**
+   * First node page freed by reorganize() and not reused yet, 0 if there is none. The others are chained from it by FreeNodePage.
+   */
+	PageId freePageNo;
+};
+
+/**
+ * @brief Written over the start of a node page that reorganize() freed, chaining it to the next free page.
+ * The rest of the page is left as it was, so the version of a freed leaf stays where a ScanCursor looks for it.
+*/
+struct FreeNodePage{
+  /**
+   * Next free page, 0 for the last one.
+   */
+	PageId nextFreePageNo;
+
+  /**
+   * 1 if the page held a leaf, 0 if it held a non-leaf node.
+   */
+	int leaf;
+};
+
+/**
+ * @brief Number of buckets in the equi-depth histogram of an index.
+ */
+const int HISTOGRAMBUCKETS = 256;
+
+/**
+ * @brief Statistics of the keys of an index, used to estimate how many entries a scan will return.
+ * They are collected whenever the index is built from the base relation and kept in their own
+ * page of the index file, whose number is stored in IndexMetaInfo::statsPageNo.
+ * Later inserts and deletes keep numEntries and the bucket counts exact, while the distinct counts and the
+ * key bounds are only partly maintained, as noted on each, until the index is rebuilt.
+ * Bucket i of the equi-depth histogram holds the keys in (bucketUpperBound[i-1], bucketUpperBound[i]],
+ * the first bucket starts at minKey. Buckets hold about the same number of entries, except that a run of
+ * equal keys is never split across two buckets.
+*/
+struct IndexStatsInfo{
+  /**
+   * Number of entries in the index.
+   */
+	int numEntries;
+
+  /**
+   * Number of distinct keys. Later inserts only count keys outside [minKey, maxKey], and deletes never lower it.
+   */
+	int distinctKeys;
+
+  /**
+   * Smallest key in the index. Widened by later inserts, but not raised by deletes.
+   */
+	int minKey;
+
+  /**
+   * Largest key in the index. Widened by later inserts, but not lowered by deletes.
+   */
+	int maxKey;
+
+  /**
+   * Number of histogram buckets in use.
+   */
+	int numBuckets;
+
+  /**
+   * Largest key of every bucket.
+   */
+	int bucketUpperBound[ HISTOGRAMBUCKETS ];
+
+  /**
+   * Number of entries in every bucket.
+   */
+	int bucketCount[ HISTOGRAMBUCKETS ];
+
+  /**
+   * Number of distinct keys in every bucket, maintained like distinctKeys.
+   */
+	int bucketDistinct[ HISTOGRAMBUCKETS ];
 };
 
+static_assert(sizeof(IndexStatsInfo) <= Page::SIZE,
+              "Index statistics must fit in one page.");
+
 /*
 Each node is a page, so once we read the page in we just cast the pointer to the page to this struct and use it to access the parts
 These structures basically are the format in which the information is stored in the pages for the index file depending on what kind of 
@@ -197,84 +466,482 @@ struct LeafNodeInt{
 	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
    */
 	PageId rightSibPageNo;
+
+  /**
+   * Incremented whenever the entries of the leaf change, so that a saved ScanCursor can tell whether its position
+   * is still valid. It takes the bytes the arrays leave free at the end of the page.
+   */
+	std::uint32_t version;
 };
 
+static_assert(sizeof(LeafNodeInt) <= Page::SIZE, "A leaf must fit in a page");
+
 
 /**
- * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
- * relation. This index supports only one scan at a time.
-*/
-class BTreeIndex {
+ * @brief Extent of the index file that leaves are allocated from, so that leaves split one after the other stay together.
+ */
+const int LEAFEXTENT = 0;
 
- private:
+/**
+ * @brief Extent of the index file that non-leaf nodes are allocated from, apart from the leaves.
+ */
+const int NONLEAFEXTENT = 1;
 
-  /**
-   * File object for the index file.
-   */
-	File		*file;
+/**
+ * @brief Number of keys of a non-leaf node when the index keeps message buffers in its non-leaf nodes.
+ * The slots of keyArray past it hold the buffer instead, and pageNoArray[INTARRAYNONLEAFSIZE] the number of messages in it.
+ */
+const int BUFFEREDNONLEAFSIZE = 255;
+
+/**
+ * @brief An insert or delete waiting in the buffer of a non-leaf node to be passed down to the leaves.
+ */
+struct IndexMessage
+{
+	int key;
+	PageId pageNo;
+	SlotId slotNo;
+	std::uint16_t insert;  // 1 for an insert, 0 for a delete
+};
+
+/**
+ * @brief Number of IndexMessage held by the buffer of a non-leaf node.
+ */
+const int MESSAGEBUFFERSIZE = ( INTARRAYNONLEAFSIZE - BUFFEREDNONLEAFSIZE ) * sizeof( int ) / sizeof( IndexMessage );
+
+/**
+ * @brief Strategy used to locate a key inside the sorted keyArray of a node.
+ */
+enum SearchStrategy
+{
+	BINARY_SEARCH = 0,				/* Plain binary search over the occupied slots */
+	INTERPOLATION_SEARCH = 1	/* Guess the slot from the first and last key, fall back to binary search on a miss */
+};
+
+/**
+ * @brief Number of slots walked from an interpolated guess before it is counted as a miss.
+ */
+const int INTERPOLATIONWINDOW = 8;
+
+/**
+ * @brief Number of interpolation probes after which the hit rate is re-evaluated.
+ */
+const int SEARCHSTATSWINDOW = 1024;
+
+/**
+ * @brief While binary search is selected, one search out of this many still probes
+ * with interpolation so that the hit rate keeps being sampled.
+ */
+const int SEARCHRESAMPLEINTERVAL = 64;
+
+/**
+ * @brief Default number of lookups advanced together, a level at a time, by BTreeIndex::lookupBatch().
+ */
+const int LOOKUPGROUPSIZE = 16;
+
+/**
+ * @brief Minimum percentage of interpolation hits within a window for interpolation to stay selected.
+ */
+const int INTERPOLATIONHITPERCENT = 50;
+
+/**
+ * @brief Number of 64 bit words in a block of a Bloom filter, so that a block fills one 64 byte cache line.
+ */
+const int BLOOMBLOCKWORDS = 8;
+
+/**
+ * @brief Number of bits of Bloom filter reserved for every key when the filter is sized.
+ */
+const int BLOOMBITSPERKEY = 12;
+
+/**
+ * @brief Number of lookups rejected by, or falsely passed by, a Bloom filter after which its false positive rate is re-evaluated.
+ */
+const int BLOOMSTATSWINDOW = 1024;
+
+/**
+ * @brief Maximum percentage of false positives within a window before a Bloom filter is rebuilt.
+ */
+const int BLOOMMAXFALSEPOSITIVEPERCENT = 5;
+
+/**
+ * @brief A block of a blocked Bloom filter. A key sets one bit in every word of the single block
+ * it hashes to, so a lookup touches one cache line and tests all its words side by side.
+ */
+struct BloomBlock
+{
+	std::uint64_t words[BLOOMBLOCKWORDS];
+};
 
+/**
+ * @brief Number of BloomBlock held by a page of the index file.
+ */
+const int BLOOMBLOCKSPERPAGE = Page::SIZE / sizeof(BloomBlock);
+
+/**
+ * @brief Class to maintain statistics of the Bloom filter of an index.
+ */
+struct BloomFilterStats
+{
   /**
-   * Buffer Manager Instance.
+   * Number of point lookups answered by the filter without descending the tree.
    */
-	BufMgr	*bufMgr;
+	std::uint64_t negatives;
 
   /**
-   * Page number of meta page.
+   * Number of point lookups passed by the filter for keys the index doesn't hold.
    */
-	PageId	headerPageNum;
+	std::uint64_t falsePositives;
 
   /**
-   * page number of root page of B+ tree inside index file.
+   * Number of times the filter was rebuilt because its false positive rate drifted.
    */
-	PageId	rootPageNum;
+	std::uint64_t rebuilds;
 
   /**
-   * Datatype of attribute over which index is built.
+   * Clear all values
    */
-	Datatype	attributeType;
+	void clear()
+	{
+		negatives = falsePositives = rebuilds = 0;
+	}
 
   /**
-   * Offset of attribute, over which index is built, inside records. 
+   * Constructor of BloomFilterStats class
    */
-	int 		attrByteOffset;
+	BloomFilterStats()
+	{
+		clear();
+	}
+};
 
+/**
+ * @brief Maximum distance, in entries, between the position a learned model predicts for a trained key and its actual position.
+ */
+const int LEARNEDERRORWINDOW = 32;
 
-  // let's just ignore these two for now
+/**
+ * @brief A segment of the piecewise linear learned model of the leaf level. Keys from firstKey up to the
+ * firstKey of the next segment are predicted at position startPos + slope * (key - firstKey), counting
+ * entries from the start of the leftmost leaf.
+ */
+struct LearnedSegment
+{
+	int firstKey;
+	int startPos;
+	double slope;
+};
+
+/**
+ * @brief Class to maintain statistics of in-node key searches of an index.
+ */
+struct NodeSearchStats
+{
   /**
-   * Number of keys in leaf node, depending upon the type of key.
+   * Number of searches which probed with interpolation.
    */
-	int			leafOccupancy;
+	std::uint64_t interpolationProbes;
 
   /**
-   * Number of keys in non-leaf node, depending upon the type of key.
+   * Number of interpolation probes which landed within INTERPOLATIONWINDOW slots of the target.
    */
-	int			nodeOccupancy;
-
-
-	// MEMBERS SPECIFIC TO SCANNING
+	std::uint64_t interpolationHits;
 
   /**
-   * True if an index scan has been started.
+   * Number of searches resolved by binary search alone.
    */
-	bool		scanExecuting;
+	std::uint64_t binarySearches;
 
   /**
-   * Index of next entry to be scanned in current leaf being scanned.
+   * Number of times the index switched its search strategy.
    */
-	int			nextEntry;
+	std::uint64_t strategySwitches;
 
   /**
-   * Page number of current page being scanned.
+   * Number of descents replaced by a prediction of the learned model.
    */
-	PageId	currentPageNum;
+	std::uint64_t modelSeeks;
 
   /**
-   * Current Page being scanned.
+   * Number of predictions of the learned model that missed their window and fell back to a descent.
    */
-	Page		*currentPageData;
+	std::uint64_t modelFallbacks;
 
   /**
-   * Low INTEGER value for scan.
+   * Clear all values
+   */
+	void clear()
+	{
+		interpolationProbes = interpolationHits = binarySearches = strategySwitches = 0;
+		modelSeeks = modelFallbacks = 0;
+	}
+
+  /**
+   * Constructor of NodeSearchStats class
+   */
+	NodeSearchStats()
+	{
+		clear();
+	}
+};
+
+
+/**
+ * @brief Reads the consistency marker of a relation: its number of pages and the last modification time
+ * of its file in nanoseconds. Indexes keep it in their meta page to tell whether the relation changed since
+ * they were last in sync with it. Returns false if the file can't be examined.
+ */
+bool readRelationMarker(const std::string & relationName, PageId & pageCount, std::int64_t & modTime);
+
+/**
+ * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+ * relation. This index supports only one scan at a time.
+*/
+class BTreeIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	BlobFile	*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Name of the base relation.
+   */
+	std::string	relationName;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Page number of the first root page. The root is a leaf for as long as rootPageNum equals this value.
+   */
+	PageId	initialRootPageNum;
+
+  /**
+   * Height of the tree, 1 while the root is still a leaf.
+   */
+	int			height;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records. 
+   */
+	int 		attrByteOffset;
+
+  /**
+   * True if the index only holds the records that satisfy predicate.
+   */
+	bool		partial;
+
+  /**
+   * Predicate of a partial index.
+   */
+	IndexPredicate	predicate;
+
+
+  // let's just ignore these two for now
+  /**
+   * Number of keys in leaf node, depending upon the type of key.
+   */
+	int			leafOccupancy;
+
+  /**
+   * Number of keys in non-leaf node, depending upon the type of key.
+   */
+	int			nodeOccupancy;
+
+
+	// MEMBERS SPECIFIC TO IN-NODE SEARCH
+
+  /**
+   * Strategy currently used to search the keyArray of nodes.
+   */
+	SearchStrategy	searchStrategy;
+
+  /**
+   * Statistics of in-node searches since the index was opened.
+   */
+	NodeSearchStats	searchStats;
+
+  /**
+   * Interpolation probes in the current evaluation window.
+   */
+	int			windowProbes;
+
+  /**
+   * Interpolation hits in the current evaluation window.
+   */
+	int			windowHits;
+
+  /**
+   * Binary searches done since interpolation was last sampled.
+   */
+	int			searchesSinceSample;
+
+
+	// MEMBERS SPECIFIC TO STATISTICS
+
+  /**
+   * Key statistics of the index. Loaded from, and written back to, the page statsPageNum.
+   */
+	IndexStatsInfo	statsInfo;
+
+  /**
+   * Page number of the statistics page, 0 if it has not been allocated yet.
+   */
+	PageId	statsPageNum;
+
+  /**
+   * True while the index is being built from the base relation. Statistics are then collected at the
+   * end of the build instead of being updated by every insertEntry().
+   */
+	bool		buildingIndex;
+
+  /**
+   * Scan of the base relation while the index is being built online, NULL otherwise.
+   */
+	FileScan	*buildScan;
+
+  /**
+   * Keys inserted so far by the build, from which statistics are collected at its end.
+   */
+	std::vector<int>	buildKeys;
+
+  /**
+   * True if the index should have a Bloom filter, which is then built along with the index.
+   */
+	bool		useBloomFilter;
+
+  /**
+   * Blocks of the Bloom filter, empty if the index has none. Point lookups for keys it rejects skip the descent.
+   */
+	std::vector<BloomBlock>	bloomBlocks;
+
+  /**
+   * First page of the Bloom filter in the index file, 0 if none has been allocated yet.
+   */
+	PageId	bloomPageNum;
+
+  /**
+   * Number of pages allocated to the Bloom filter.
+   */
+	int		bloomPageCount;
+
+  /**
+   * True if bloomBlocks changed since it was last written to its pages.
+   */
+	bool		bloomDirty;
+
+  /**
+   * Pages of leaves and of non-leaf nodes freed by reorganize(), handed out again before new pages are allocated.
+   * A page is only reused for a node of the kind it held, so that a leaf page stays a leaf and its version keeps growing.
+   */
+	std::set<PageId>	freeLeafPages;
+	std::set<PageId>	freeNonLeafPages;
+
+  /**
+   * True if the free pages changed since they were last chained in the index file.
+   */
+	bool		freePagesDirty;
+
+  /**
+   * Bloom filter statistics.
+   */
+	BloomFilterStats	bloomStats;
+
+  /**
+   * Lookups rejected or falsely passed by the Bloom filter in the current window.
+   */
+	int		bloomWindowLookups;
+
+  /**
+   * False positives of the Bloom filter in the current window.
+   */
+	int		bloomWindowFalsePositives;
+
+  /**
+   * Segments of the learned model, in order of firstKey.
+   */
+	std::vector<LearnedSegment>	modelSegments;
+
+  /**
+   * Page numbers of the leaves the learned model was trained on, left to right.
+   */
+	std::vector<PageId>	modelLeafPages;
+
+  /**
+   * Position of the first entry of every leaf in modelLeafPages.
+   */
+	std::vector<int>	modelLeafStarts;
+
+  /**
+   * Number of entries the learned model was trained on.
+   */
+	int		modelEntries;
+
+  /**
+   * True while the learned model matches the leaves; any insert or delete clears it.
+   */
+	bool		modelValid;
+
+  /**
+   * First page of the learned model in the index file, 0 if none has been allocated yet.
+   */
+	PageId	modelPageNum;
+
+  /**
+   * Number of pages allocated to the learned model.
+   */
+	int		modelPageCount;
+
+  /**
+   * True if inserts and deletes are buffered in the non-leaf nodes and passed down in batches.
+   */
+	bool		bufferedNodes;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned.
+   */
+	int			nextEntry;
+
+  /**
+   * Page number of current page being scanned.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current Page being scanned.
+   */
+	Page		*currentPageData;
+
+  /**
+   * Low INTEGER value for scan.
    */
 	int			lowValInt;
 
@@ -299,103 +966,537 @@ class BTreeIndex {
 	double	highValDouble;
 
   /**
-   * High STRING value for scan.
-   */
-	std::string highValString;
-	
+   * High STRING value for scan.
+   */
+	std::string highValString;
+	
+  /**
+   * Low Operator. Can only be GT(>) or GTE(>=).
+   */
+	Operator	lowOp;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+  /**
+   * Number of entries in the current leaf.
+   */
+	int			leafEntryCount;
+
+  /**
+   * Index of the first entry of the current leaf past the high bound of the range, leafEntryCount if the range goes on in the right sibling.
+   */
+	int			leafRangeEnd;
+
+  /**
+   * Kernel finding leafRangeEnd, instantiated for the low and high operators of the range being scanned.
+   */
+	int			(*rangeEndKernel)(const int *keyArray, int first, int count, int lowVal, int highVal);
+
+  /**
+   * True if the current scan has a residual filter on the key.
+   */
+	bool		scanFiltered;
+
+  /**
+   * Residual filter of the current scan.
+   */
+	KeyRange<int>	scanFilter;
+
+  /**
+   * True if the current leaf window is returned through leafSelection, false if it is returned whole.
+   */
+	bool		windowSelected;
+
+  /**
+   * Indexes of the entries of the current leaf window that pass scanFilter and have no buffered message, in order.
+   */
+	std::vector<int>	leafSelection;
+
+  /**
+   * End of the current leaf window: the number of entries in leafSelection, or leafRangeEnd if the window is returned whole.
+   */
+	int			windowEnd;
+
+  /**
+   * Position in the window of the next entry to return, an index into leafSelection or a slot of the leaf.
+   */
+	int			nextRun;
+
+  /**
+   * End of the run of the window returned without comparisons: windowEnd, or the first position past the next buffered insert.
+   */
+	int			runEnd;
+
+  /**
+   * True if the current scan returned an entry, whose key and record id are then in lastKeyReturned and lastRidReturned.
+   */
+	bool		entryReturned;
+
+  /**
+   * Key of the last entry returned by the current scan.
+   */
+	int			lastKeyReturned;
+
+  /**
+   * Record id of the last entry returned by the current scan.
+   */
+	RecordId	lastRidReturned;
+
+  /**
+   * Number of entries the current scan returns at most, 0 if it is unlimited.
+   */
+	std::size_t	scanLimit;
+
+  /**
+   * Number of entries returned by the current scan.
+   */
+	std::size_t	scanReturned;
+
+  /**
+   * Ranges of the current scan in ascending key order. A single range scan holds exactly one.
+   */
+	std::vector< KeyRange<int> >	scanRanges;
+
+  /**
+   * Index into scanRanges of the range being scanned. Its bounds are copied into lowValInt, lowOp, highValInt and highOp.
+   */
+	std::size_t	currentRange;
+
+  /**
+   * Entries inserted by messages still buffered when the scan started, in key order, restricted to scanRanges.
+   */
+	std::vector<IndexMessage>	scanInserts;
+
+  /**
+   * Index into scanInserts of the next one to return.
+   */
+	std::size_t	nextInsert;
+
+  /**
+   * Every entry with a message buffered when the scan started, sorted by key and rid. The leaf entries among them
+   * are skipped, since the messages decide whether they exist.
+   */
+	std::vector<IndexMessage>	scanMessages;
+
+	
+ public:
+
+  /**
+   * BTreeIndex Constructor. 
+	 * Check to see if the corresponding index file exists. If so, validate its meta page against the parameters
+	 * and open the file without scanning the relation, unless the relation changed since the index was built.
+	 * If not, or if it is stale, create it and insert entries for every tuple in the base relation using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @param online							If true, a new index is not built here but step by step through buildStep(), so that the relation can be written to in between
+   * @param bloomFilter					If true, the index gets a Bloom filter for point lookups if it doesn't have one yet. An index file with a filter always keeps using it
+   * @param bufferedNodes				If true, a new index buffers inserts and deletes in its non-leaf nodes. An existing index file keeps the mode it was created with
+   * @param predicate						If not NULL, the index is partial and only holds the records that satisfy it. Its file name ends in the predicate, e.g. relA.0.where8gt0
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type, predicate etc.) do not match with values received through constructor parameters.
+   */
+	BTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType, const bool online = false,
+						const bool bloomFilter = false, const bool bufferedNodes = false, const IndexPredicate *predicate = NULL);
+	
+
+  /**
+   * BTreeIndex Destructor. 
+	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
+	 * and delete file instance thereby closing the index file.
+	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself. 
+	 * */
+	~BTreeIndex();
+
+
+  /**
+	 * Insert a new entry using the pair <value,rid>. 
+	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
+	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
+	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
+	 * Make sure to unpin pages as soon as you can.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	void insertEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Delete the entry for the pair <value,rid>.
+	 * Descends to the first leaf that can hold the key and walks right through entries with the same key until the rid is found.
+	 * The entry is removed from its leaf; leaves are not merged or redistributed, and a leaf left empty stays in the sibling chain.
+	 * Must not be called while a scan is executing.
+   * @param key			Key to delete, pointer to integer/double/char string
+   * @param rid			Record ID of the record whose entry is deleted.
+	 * @throws  NoSuchKeyFoundException If the index holds no entry for the pair.
+	**/
+	void deleteEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Returns true if the index holds an entry for the pair <value,rid>.
+	 * Must not be called while a scan is executing.
+   * @param key			Key to look for, pointer to integer/double/char string
+   * @param rid			Record ID to look for.
+	**/
+	bool containsEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Continue an online build by inserting the entries of the next recordCount records of the base relation.
+	 * The relation is read from disk, so it has to be flushed before the build starts; writes made to it during the build
+	 * may or may not be seen and have to be applied afterwards by the writer, see Relation::startIndexBuild().
+	 * Statistics are collected once the last record has been read. Returns true, without doing anything, once the build is complete.
+   * @param recordCount	Maximum number of records to read in this step.
+   * @return  True if the build is complete.
+	**/
+	bool buildStep(const int recordCount);
+
+
+  /**
+	 * Returns true while an online build has not read the whole relation yet.
+	**/
+	bool isBuilding() const { return buildScan != NULL; }
+
+
+  /**
+	 * Build several indexes of one relation with a single scan of it, instead of one scan per index. The indexes
+	 * are constructed with online set, and those that were opened rather than created are left alone. The entries
+	 * of every index are extracted from each record as it is read, sorted on a thread per index, and bulk loaded
+	 * into leaves packed full, like reorganize() leaves them. No buildStep() may have been called on the indexes.
+   * @param indexes	Indexes of the same relation to build
+	**/
+	static void buildIndexes(const std::vector<BTreeIndex*> & indexes);
+
+
+  /**
+	 * Record the current state of the base relation in the meta page, as the state the index reflects.
+	 * Called after building, and by writers that keep the index in sync with the relation once they have flushed it.
+	**/
+	void syncRelationMarker();
+
+
+  /**
+	 * Begin a filtered scan of the index.  For instance, if the method is called 
+	 * using ("a",GT,"d",LTE) then we should seek all entries with a value 
+	 * greater than "a" and less than or equal to "d".
+	 * If another scan is already executing, that needs to be ended here.
+	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
+	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+	 * A scan with a limit, e.g. for the first K matching entries, unpins its leaf as soon as it returned the limit,
+	 * and never reads a leaf beyond it; the scanNext() after that throws IndexScanCompletedException.
+	 * A partial index only answers a scan it covers: one whose range implies its predicate (see coversRange()), or
+	 * one whose query predicate does (see coversQuery()).
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @param limit	Maximum number of entries to return, 0 for no limit
+   * @param queryPredicate	Predicate the records of the query satisfy, NULL if it has none
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  BadScanParamException If the index is partial and doesn't cover the scan
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp, std::size_t limit = 0,
+			const IndexPredicate *queryPredicate = NULL);
+
+
+  /**
+	 * Begin a scan over several disjoint ranges of the index in a single traversal, e.g. for IN lists
+	 * (each value given as a [v, v] range) or OR-ed ranges. The ranges must be sorted by key and must not overlap.
+	 * scanNext() returns the entries of all ranges in key order. When one range is exhausted the scan stays in the
+	 * current leaf if the next range starts there, and only descends from the root again when it starts beyond it.
+	 * If another scan is already executing, that needs to be ended here.
+	 * A residual filter on the key, e.g. the part of a predicate that the ranges don't cover, is evaluated on the
+	 * keys of each leaf in one pass with selectKeyRange(), and scanNext() only returns the entries it selects.
+   * @param ranges	Ranges to scan, in ascending key order
+   * @param keyFilter	Residual predicate on the key, or NULL for none
+   * @param limit	Maximum number of entries to return over all ranges, 0 for no limit
+   * @param queryPredicate	Predicate the records of the query satisfy, NULL if it has none
+   * @throws  BadOpcodesException If a lowOp or highOp does not contain one of their their expected values
+   * @throws  BadScanrangeException If a range or the filter has lowVal > highVal, or the ranges are unsorted or overlap
+   * @throws  BadScanParamException If the index is partial and doesn't cover every range
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies any of the ranges.
+	**/
+	void startScan(const std::vector<ScanRange>& ranges, const ScanRange* keyFilter = NULL, std::size_t limit = 0,
+			const IndexPredicate *queryPredicate = NULL);
+
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	void scanNext(RecordId& outRid);  // returned record id
+
+
+  /**
+	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	void endScan();
+
+
+  /**
+	 * Save the position of the current scan, so that resumeScan() can continue it later, after endScan() or on
+	 * another instance of the index. Only single range scans without a key filter can be saved.
+   * @param cursor	Position of the scan, returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws BadScanParamException If the scan has several ranges or a key filter.
+	**/
+	void saveScan(ScanCursor & cursor);
+
+
+  /**
+	 * Continue a scan saved by saveScan(). If the leaf of the saved position hasn't changed since, the scan goes on
+	 * from it without a descent. Otherwise, or if its page can't be read, it descends to the last key returned and continues after the last entry
+	 * returned, or after every entry with that key if that entry was deleted meanwhile.
+	 * Buffered messages are flushed first. If another scan is already executing, that needs to be ended here.
+	 * Unlike startScan(), this doesn't throw if no entry is left: the next scanNext() does.
+   * @param cursor	Position saved by saveScan()
+   * @throws  BadOpcodesException If the operators of the cursor are not GT/GTE and LT/LTE
+   * @throws  BadScanrangeException If the range of the cursor has lowVal > highVal
+	**/
+	void resumeScan(const ScanCursor & cursor);
+
+  /**
+	 * Returns the in-node search statistics of this index.
+	**/
+	NodeSearchStats & getSearchStats()
+	{
+		return searchStats;
+	}
+
+  /**
+	 * Clears the in-node search statistics of this index.
+	**/
+	void clearSearchStats()
+	{
+		searchStats.clear();
+	}
+
+  /**
+	 * Returns the strategy currently used to search the keyArray of nodes.
+	**/
+	SearchStrategy getSearchStrategy() const
+	{
+		return searchStrategy;
+	}
+
+  /**
+	 * Returns the offset of the indexed attribute inside records.
+	**/
+	int getAttrByteOffset() const
+	{
+		return attrByteOffset;
+	}
+
+
+  /**
+	 * Returns true if the index is partial.
+	**/
+	bool isPartial() const
+	{
+		return partial;
+	}
+
+
+  /**
+	 * Returns true if the index holds an entry for the record, i.e. if it isn't partial or the record satisfies its predicate.
+   * @param record	Bytes of the record
+	**/
+	bool coversRecord(const char *record) const;
+
+
+  /**
+	 * Returns true if the index holds every record that satisfies a predicate of a query, so that the query can scan it.
+	 * That is the case if the index isn't partial or if the query predicate implies the predicate of the index.
+   * @param queryPredicate	Predicate of the query, NULL if it has none
+	**/
+	bool coversQuery(const IndexPredicate *queryPredicate) const;
+
+
+  /**
+	 * Returns true if the index holds every record with a key in a range, which a partial index only does if its
+	 * predicate is on the indexed attribute and the range implies it.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+	**/
+	bool coversRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp) const;
+
+  /**
+	 * Returns the datatype of the indexed attribute.
+	**/
+	Datatype getAttrType() const
+	{
+		return attributeType;
+	}
+
+  /**
+	 * Returns the statistics of the Bloom filter of this index.
+	**/
+	BloomFilterStats & getBloomStats()
+	{
+		return bloomStats;
+	}
+
+  /**
+	 * Returns true if the index has a Bloom filter.
+	**/
+	bool hasBloomFilter() const
+	{
+		return !bloomBlocks.empty();
+	}
+
   /**
-   * Low Operator. Can only be GT(>) or GTE(>=).
-   */
-	Operator	lowOp;
+	 * Train a piecewise linear model over the leaf level and store it in the index file. Until the next insertEntry()
+	 * or deleteEntry(), scans and lookups jump straight to the predicted leaf instead of descending through the
+	 * non-leaf levels. Meant for indexes that are rebuilt rather than updated. Buffered messages are flushed first.
+	 * An empty index gets no model.
+	**/
+	void trainModel();
 
   /**
-   * High Operator. Can only be LT(<) or LTE(<=).
-   */
-	Operator	highOp;
+	 * Returns true if the index has a learned model trained since its last modification.
+	**/
+	bool hasValidModel() const
+	{
+		return modelValid;
+	}
 
-	
- public:
+  /**
+	 * Pass every buffered message down to the leaves. Afterwards the leaves hold exactly the entries of the index.
+	**/
+	void flushMessages();
 
   /**
-   * BTreeIndex Constructor. 
-	 * Check to see if the corresponding index file exists. If so, open the file.
-	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
-   *
-   * @param relationName        Name of file.
-   * @param outIndexName        Return the name of index file.
-   * @param bufMgrIn						Buffer Manager Instance
-   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
-   * @param attrType						Datatype of attribute over which index is built
-   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
-   */
-	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
-	
+	 * Returns the number of inserts and deletes buffered in the non-leaf nodes.
+	**/
+	int countPendingMessages();
 
   /**
-   * BTreeIndex Destructor. 
-	 * End any initialized scan, flush index file, after unpinning any pinned pages, from the buffer manager
-	 * and delete file instance thereby closing the index file.
-	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself. 
-	 * */
-	~BTreeIndex();
+	 * Returns true if the index buffers inserts and deletes in its non-leaf nodes.
+	**/
+	bool hasBufferedNodes() const
+	{
+		return bufferedNodes;
+	}
 
+  /**
+	 * Returns the fraction of hops along the leaf chain that do not lead to the next page of the index file,
+	 * 0 for an index with a single leaf. Range scans read leaves with random I/O in proportion to it.
+	 * Must not be called while a scan is executing.
+	**/
+	double leafFragmentation();
 
   /**
-	 * Insert a new entry using the pair <value,rid>. 
-	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
-	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
-	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
-	 * Make sure to unpin pages as soon as you can.
-   * @param key			Key to insert, pointer to integer/double/char string
-   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	 * Rewrite the leaves in key order, packed full, into consecutive pages, and build the non-leaf levels on top of them.
+	 * The old nodes are freed and reused: the leaves go into a run of freed leaf pages if there is one long enough,
+	 * and into new pages at the end of the index file otherwise. Reorganizing an index that didn't grow since the last
+	 * time therefore doesn't grow the file.
+	 * Buffered messages are flushed first, and the learned model is invalidated. Must not be called while a scan is executing.
 	**/
-	void insertEntry(const void* key, const RecordId rid);
+	void reorganize();
 
+  /**
+	 * Write the entries of the index to a read-only snapshot file, to be opened with IndexSnapshot. The leaves are
+	 * packed full and laid out back to back in key order, followed by the first key of every leaf as the only inner
+	 * level. Buffered messages are flushed first. An existing file with the same name is replaced.
+   * @param snapshotName	Name of the snapshot file.
+   * @throws  FileWriteException If the file can't be created or written completely. A partly written file is removed.
+	**/
+	void exportSnapshot(const std::string & snapshotName);
 
   /**
-	 * Begin a filtered scan of the index.  For instance, if the method is called 
-	 * using ("a",GT,"d",LTE) then we should seek all entries with a value 
-	 * greater than "a" and less than or equal to "d".
-	 * If another scan is already executing, that needs to be ended here.
-	 * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
-	 * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+	 * Scan a range with several threads. The separator keys of the non-leaf levels split the range into up to
+	 * workerCount sub-ranges holding about as many leaves each, and every sub-range is scanned by its own thread
+	 * with its own pins. Buffered messages are flushed first. No other method of the index, nor of the buffer
+	 * manager, may be called until it returns.
    * @param lowVal	Low value of range, pointer to integer / double / char string
    * @param lowOp		Low operator (GT/GTE)
    * @param highVal	High value of range, pointer to integer / double / char string
    * @param highOp	High operator (LT/LTE)
-   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @param workerCount	Maximum number of threads.
+   * @param outRids	Record ids of the entries of each sub-range, in key order, returned in this. The sub-ranges
+   *               	follow each other, so the lists put one after the other are in key order too.
+   * @param queryPredicate	Predicate the records of the query satisfy, NULL if it has none
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
    * @throws  BadScanrangeException If lowVal > highval
-	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+   * @throws  BadScanParamException If the index is partial and doesn't cover the scan, like startScan()
+	**/
+	void parallelScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			const int workerCount, std::vector< std::vector<RecordId> > & outRids, const IndexPredicate *queryPredicate = NULL);
+
+  /**
+	 * Scan a range with several threads like the above, and return the record ids of all the sub-ranges merged in key order.
 	**/
-	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+	void parallelScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+			const int workerCount, std::vector<RecordId> & outRids, const IndexPredicate *queryPredicate = NULL);
 
+  /**
+	 * Look up a batch of keys, for probes against an index whose nodes are in the buffer pool. Lookups go down
+	 * the tree in groups: every node of a level is pinned and its cache lines prefetched for the whole group before
+	 * any of them is searched, so the cache misses of the group overlap instead of stalling each lookup in turn.
+	 * Buffered messages are flushed first. Must not be called while a scan is executing.
+   * @param keys	Keys to look up.
+   * @param outRids	Record ids of the entries with each key, in key order, returned in this, one list per key.
+   * @param groupSize	Number of lookups going down the tree together. At most that many pages are pinned at a time.
+	**/
+	void lookupBatch(const std::vector<int> & keys, std::vector< std::vector<RecordId> > & outRids,
+			const int groupSize = LOOKUPGROUPSIZE);
 
   /**
-	 * Fetch the record id of the next index entry that matches the scan.
-	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
-   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
-	 * @throws ScanNotInitializedException If no scan has been initialized.
-	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	 * Returns the height of the tree, 1 while the root is still a leaf.
 	**/
-	void scanNext(RecordId& outRid);  // returned record id
+	int getHeight() const
+	{
+		return height;
+	}
 
+  /**
+	 * Returns the key statistics collected when the index was built.
+	**/
+	const IndexStatsInfo & getIndexStats() const
+	{
+		return statsInfo;
+	}
 
   /**
-	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
-	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * Estimates the number of entries a scan with the same parameters as startScan() would return,
+	 * from the equi-depth histogram of the index. Keys inside a bucket are assumed to be spread evenly,
+	 * and an equality range is estimated as the average number of entries per distinct key of its bucket.
+	 * Inserts and deletes keep the entry counts exact, but the distinct counts and the bounds of the first and last
+	 * bucket are only recomputed when the index is rebuilt, see IndexStatsInfo.
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @return Estimated number of entries in the range.
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
 	**/
-	void endScan();
+	double estimateRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
 
   /**
-  * Finds the closest pageId to the query.
+  * Finds the child page of a non-leaf node that holds the first entry satisfying the low bound of a scan.
   * 
   * @param node the node whose children to search in
   * @param lowValParam the low value to compare to
-  * @param greaterThan the greater value to compare to
+  * @param greaterThan the low operator (GT/GTE) of the scan
   * @return PageId the pageId of the page that might have the values desired
   */
-  PageId findLeastPageId(NonLeafNodeInt node, int lowValParam, Operator greaterThan);
+  PageId findLeastPageId(NonLeafNodeInt *node, int lowValParam, Operator greaterThan);
 
   /**
   * Gets the root node
@@ -412,6 +1513,17 @@ class BTreeIndex {
   */
   NonLeafNodeInt getNonLeafNodeFromPage(PageId pageId);
 
+  /**
+   * @brief Recursively descends from the given page to the leaf the entry belongs to and inserts it there.
+   * The page passed in must be pinned; it is unpinned before returning.
+   * If the node had to be split, child_data returns the key and page number to be added to the parent, otherwise nullptr.
+   * 
+   * @param Page_currently 
+   * @param Page_number_currently 
+   * @param is_leaf 
+   * @param current_data_to_enter 
+   * @param child_data 
+   */
   void search(Page *Page_currently, PageId Page_number_currently, bool is_leaf, const RIDKeyPair<int> current_data_to_enter, PageKeyPair<int> *&child_data);
 
   /**
@@ -433,4 +1545,313 @@ class BTreeIndex {
    * @param key_and_page 
    */
   void insert_into_nonleaf(NonLeafNodeInt *Node_nonleaf, PageKeyPair<int> *key_and_page);
+
+  /**
+   * @brief The insert_into_leaf function finds the slot of the key in a leaf which is not full and shifts the entries after it.
+   * 
+   * @param Node_leaf 
+   * @param key_and_rid 
+   */
+  void insert_into_leaf(LeafNodeInt *Node_leaf, const RIDKeyPair<int> key_and_rid);
+
+  /**
+   * @brief The splitter splits a full non-leaf node, adds the pending child entry to the correct half and
+   * returns the middle key with the new page through child_data to be pushed up. Both pages are unpinned.
+   * 
+   * @param node_old 
+   * @param page_num_old 
+   * @param child_data 
+   */
+  void splitter(NonLeafNodeInt *node_old, PageId page_num_old, PageKeyPair<int> *&child_data);
+
+  /**
+   * @brief The leaf_splitter splits a full leaf, inserts the entry into the correct half and links the new
+   * leaf into the sibling chain. The first key of the new leaf is copied up through child_data. Both pages are unpinned.
+   * 
+   * @param leaf_old 
+   * @param page_num_old 
+   * @param key_and_rid 
+   * @param child_data 
+   */
+  void leaf_splitter(LeafNodeInt *leaf_old, PageId page_num_old, const RIDKeyPair<int> key_and_rid, PageKeyPair<int> *&child_data);
+
+  /**
+   * @brief The root_changer allocates a new root above the old one after the old root was split and records it in the meta page.
+   * 
+   * @param page_num_old 
+   * @param child_data 
+   */
+  void root_changer(PageId page_num_old, PageKeyPair<int> *child_data);
+
+  /**
+   * @brief Returns the number of keys stored in a leaf. Occupied slots are packed to the left, so this is a binary search
+   * for the first slot with an empty record id.
+   * 
+   * @param Node_leaf 
+   * @return int 
+   */
+  int getLeafOccupancy(const LeafNodeInt *Node_leaf);
+
+  /**
+   * @brief Returns the number of keys stored in a non-leaf, which is one less than the number of child pages.
+   * 
+   * @param Node_nonleaf 
+   * @return int 
+   */
+  int getNonLeafOccupancy(const NonLeafNodeInt *Node_nonleaf);
+
+  /**
+   * @brief Finds the first slot of a sorted key array whose key is greater than or equal to (inclusive)
+   * or strictly greater than (not inclusive) the given key. Returns length if there is no such slot.
+   * Uses the current search strategy and updates the search statistics.
+   * 
+   * @param keyArray 
+   * @param length number of occupied slots
+   * @param key 
+   * @param inclusive 
+   * @return int 
+   */
+  int findKeyIndex(const int *keyArray, int length, int key, bool inclusive);
+
+ private:
+
+  /**
+   * Opens an existing index file and loads the root page, height and statistics from its meta page.
+   * Returns false, leaving no file open, if the file doesn't exist or is stale and has been removed.
+   * @throws  BadIndexInfoException If the meta page doesn't match the parameters the index was constructed with.
+   */
+  bool openIndexFile(const std::string & indexName, const std::string & relationName);
+
+  /**
+   * Creates a new index file holding the meta page and an empty leaf as root.
+   */
+  void createIndexFile(const std::string & indexName, const std::string & relationName);
+
+  /**
+   * Inserts entries for every tuple of the base relation, then collects statistics and records
+   * the state of the relation the index was built from in the meta page.
+   */
+  void buildIndex(const std::string & relationName);
+
+  /**
+   * Opens the scan of the base relation that buildStep() reads from.
+   */
+  void startBuild(const std::string & relationName);
+
+  /**
+   * Replaces the tree with one built bottom up from entries sorted by key: leaves packed full in consecutive new
+   * pages and non-leaf levels on top of them. Used by reorganize() and buildIndexes().
+   */
+  void bulkLoad(const std::vector<int> & keys, const std::vector<RecordId> & rids);
+
+  /**
+   * Allocates the page of a new node, reusing a free page of the same kind if there is one, and taking one from
+   * the extent of that kind otherwise. The page is returned zeroed, except that a leaf continues the version of
+   * the leaf that had the page before.
+   */
+  void allocNodePage(bool leaf, PageId & pageNum, Page *& page);
+
+  /**
+   * Adds the pages of every node of the tree to the free pages, except the first root.
+   */
+  void freeTreePages();
+
+  /**
+   * Chains the free pages in the index file and saves the first one in the meta page.
+   */
+  void writeFreePages();
+
+  /**
+   * Reads the chain of free pages starting at a page.
+   */
+  void readFreePages(PageId pageNum);
+
+  /**
+   * Inserts an entry straight into its leaf, splitting nodes up to the root as needed.
+   */
+  void insertIntoTree(const RIDKeyPair<int> & entry);
+
+  /**
+   * Removes the entry for the pair (key, rid) from its leaf. Returns false if there is none.
+   */
+  bool deleteFromTree(int key, const RecordId & rid);
+
+  /**
+   * Appends a message to the buffer of the root, making room by flushing the root first if it is full.
+   */
+  void enqueueMessage(int key, const RecordId & rid, bool insert);
+
+  /**
+   * Passes the messages of a node routed to its busiest child down as one batch: into the buffer of the child,
+   * after flushing the child if it lacks room, or, for the last non-leaf level, into the leaves in key order.
+   */
+  void flushNode(PageId nodeNum);
+
+  /**
+   * Returns the first non-leaf node, top-down, with a message in its buffer, or Page::INVALID_NUMBER if there is none.
+   */
+  PageId findBufferedNode();
+
+  /**
+   * Collects the messages of every buffer, oldest first: deeper levels before higher ones, and buffer order within a node.
+   */
+  void gatherMessages(std::vector<IndexMessage> & messages);
+
+  /**
+   * Returns 1 if the newest message on the path of the key inserts the pair (key, rid), 0 if it deletes it and -1 if there is none.
+   */
+  int pendingMessage(int key, const RecordId & rid);
+
+  /**
+   * Fills scanInserts and scanMessages from the buffered messages for the ranges in scanRanges.
+   */
+  void prepareBufferedScan();
+
+  /**
+   * Finds the entry for the pair (key, rid). Returns true and leaves its leaf pinned, with keyIndex set to
+   * the slot of the entry, if there is one. Otherwise returns false with no page pinned.
+   */
+  bool findEntry(int key, const RecordId & rid, PageId & pageNum, Page *& page, int & keyIndex);
+
+  /**
+   * Binary search for the first slot in [low, high) satisfying the findKeyIndex() condition.
+   */
+  int binarySearchKeyIndex(const int *keyArray, int low, int high, int key, bool inclusive);
+
+  /**
+   * Interpolation search used by findKeyIndex(). Sets hit if the guess was within INTERPOLATIONWINDOW slots.
+   */
+  int interpolationSearchKeyIndex(const int *keyArray, int length, int key, bool inclusive, bool &hit);
+
+  /**
+   * Records the outcome of an interpolation probe and switches strategy at the end of a window.
+   */
+  void recordInterpolationProbe(bool hit);
+
+  /**
+   * Computes the key statistics from all keys inserted while building the index and writes them out.
+   */
+  void collectStats(std::vector<int>& keys);
+
+  /**
+   * Accounts for a key inserted after the statistics were collected. The key is counted as distinct only if it
+   * lies outside [minKey, maxKey].
+   */
+  void updateStats(int key);
+
+  /**
+   * Accounts for a key deleted after the statistics were collected. Distinct counts and the key bounds are kept,
+   * unless the index is left empty.
+   */
+  void removeStats(int key);
+
+  /**
+   * Writes statsInfo to the statistics page, allocating the page and recording it in the meta page first if needed.
+   */
+  void writeStats();
+
+  /**
+   * Returns false if the Bloom filter rules the key out, counting a negative. Always true without a filter.
+   */
+  bool bloomMayContain(int key);
+
+  /**
+   * Adds a key to the Bloom filter, if there is one.
+   */
+  void bloomAdd(int key);
+
+  /**
+   * Records that a key passed by the Bloom filter is not in the index, and rebuilds the filter
+   * at the end of a window whose false positive rate exceeds BLOOMMAXFALSEPOSITIVEPERCENT.
+   */
+  void recordBloomFalsePositive();
+
+  /**
+   * Sizes the Bloom filter for the keys, fills it with them and writes it out.
+   */
+  void buildBloomFilter(const std::vector<int>& keys);
+
+  /**
+   * Rebuilds the Bloom filter from the keys in the leaves, dropping the bits of deleted keys.
+   */
+  void rebuildBloomFilter();
+
+  /**
+   * Writes the Bloom filter to its pages, allocating a new run of pages and recording it in the meta page if it outgrew them.
+   */
+  void writeBloomFilter();
+
+  /**
+   * Writes the learned model to its pages, allocating a new run of pages if it outgrew them, along with the meta page.
+   */
+  void writeModel();
+
+  /**
+   * Marks the learned model stale in memory and in the meta page, so that lookups descend through the tree again.
+   */
+  void invalidateModel();
+
+  /**
+   * Finds the leaf the learned model predicts for the bound (key, inclusive), leaving it pinned. Returns false with
+   * nothing pinned if the prediction can't be confirmed to lie at or before the first qualifying entry.
+   */
+  bool modelSeek(int key, bool inclusive, PageId & pageNum, Page *& page);
+
+  /**
+   * Descends from the root to the leaf that holds the first entry satisfying the bound (key, lowOp), leaving that leaf pinned.
+   */
+  void descendToLeaf(int key, Operator lowOp, PageId & pageNum, Page *& page);
+
+  /**
+   * Positions the scan on the first entry of the range in lowValInt/lowOp/highValInt/highOp. Stays in the pinned
+   * leaf if the range starts in it, otherwise descends from the root. Exactly one leaf is pinned afterwards.
+   * Returns false if no entry falls in the range.
+   */
+  bool seekRange();
+
+  /**
+   * Moves the scan to the next range of scanRanges that has an entry. Returns false if there is none left.
+   */
+  bool nextRange();
+
+  /**
+   * Sets leafEntryCount and leafRangeEnd for the leaf in currentPageData, counting from nextEntry. If the scan has a
+   * residual filter or buffered messages, selects the entries of that window passing the filter and without a message.
+   */
+  void findLeafRangeEnd();
+
+  /**
+   * Sets runEnd, so that the run of the window ends before the entries that follow the next buffered insert.
+   */
+  void findLeafRun();
+
+  /**
+   * Ends a limited scan that returned its limit: unpins its leaf and drops the entries it won't return.
+   */
+  void releaseLimitedScan();
+
+  /**
+   * Returns up to parts - 1 distinct separator keys in (low, high], evenly spread over the separators of the highest
+   * non-leaf level that has enough of them in the range, or of the lowest non-leaf level.
+   */
+  std::vector<int> partitionRange(int low, int high, int parts);
+
+  /**
+   * Appends the record ids of the entries with keys in [low, high] to outRids, in key order. Run by the threads of
+   * parallelScan(); it only touches the buffer manager while holding bufMgrMutex and changes no member.
+   */
+  void scanPartition(int low, int high, std::vector<RecordId> & outRids, std::mutex & bufMgrMutex);
+
+  /**
+   * Prefetches the cache lines of a pinned node that a search of it reads first: the middle of its keys and the
+   * middle of the array its occupancy is found from.
+   */
+  void prefetchNode(const Page *page, bool isLeaf);
+
+  /**
+   * Runs lookups and scans as coroutines over the same descent.
+   */
+  friend class AsyncIndexScheduler;
+};
+
 }
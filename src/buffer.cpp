@@ -152,6 +152,20 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 }
 
 
+bool BufMgr::isResident(const File* file, const PageId pageNo)
+{
+  FrameId frameNo;
+  try
+  {
+    hashTable->lookup(file, pageNo, frameNo);
+    return true;
+  }
+  catch(const HashNotFoundException &e)
+  {
+    return false;
+  }
+}
+
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
   // lookup in hashtable
@@ -168,7 +182,7 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
   else bufDescTable[frameNo].pinCnt--;
 }
 
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
+void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page, const int extent) 
 {
   FrameId frameNo;
 
@@ -177,7 +191,7 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
+  bufPool[frameNo] = file->allocatePage(pageNo, extent);
   page = &bufPool[frameNo];
 
   // set up the entry properly
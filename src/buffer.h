@@ -229,6 +229,16 @@ class BufMgr
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Checks whether a page is in the buffer pool, in which case readPage() doesn't read it from the file.
+	 * The page is not pinned and the check doesn't count as an access.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file
+	 * @return True if the page is in the buffer pool.
+	 */
+  bool isResident(const File* file, const PageId PageNo);
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -246,8 +256,9 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
 	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @param extent	Extent of the file the page is allocated from, see File::allocatePage().
 	 */
-  void allocPage(File* file, PageId &PageNo, Page*& page); 
+  void allocPage(File* file, PageId &PageNo, Page*& page, const int extent = 0); 
 
 	/**
 	 * Writes out all dirty pages of the file to disk.
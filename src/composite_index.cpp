@@ -0,0 +1,562 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "composite_index.h"
+#include <algorithm>
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/badgerdb_exception.h"
+
+namespace badgerdb
+{
+
+/**
+ * Orders normalized keys. The length is fixed, so the compiler turns the memcmp into a few wide compares.
+ */
+static bool keyLess(const CompositeKey & a, const CompositeKey & b)
+{
+	return memcmp(a.bytes, b.bytes, COMPOSITEKEYSIZE) < 0;
+}
+
+/**
+ * Returns the number of bytes an attribute takes in a normalized key.
+ */
+static int attributeLength(const CompositeAttribute & attribute)
+{
+	switch(attribute.attrType) {
+		case INTEGER: return sizeof(std::uint32_t);
+		case DOUBLE: return sizeof(std::uint64_t);
+		default: return attribute.length;
+	}
+}
+
+/**
+ * Writes the low bytes of a value most significant first.
+ */
+static void writeBigEndian(std::uint64_t value, int length, unsigned char *out)
+{
+	for(int i = length - 1; i >= 0; i--) {
+		out[i] = static_cast<unsigned char>(value);
+		value >>= 8;
+	}
+}
+
+/**
+ * Encodes an attribute value in normalized form. Returns the number of bytes written.
+ */
+static int encodeAttribute(const CompositeAttribute & attribute, const void *value, unsigned char *out)
+{
+	switch(attribute.attrType) {
+		case INTEGER: {
+			// flipping the sign bit puts negative values before positive ones
+			std::uint32_t bits = static_cast<std::uint32_t>(*reinterpret_cast<const int*>(value));
+			writeBigEndian(bits ^ 0x80000000U, sizeof(bits), out);
+			return sizeof(bits);
+		}
+		case DOUBLE: {
+			// -0.0 and 0.0 are the same key
+			double number = *reinterpret_cast<const double*>(value);
+			if(number == 0.0) number = 0.0;
+			std::uint64_t bits;
+			memcpy(&bits, &number, sizeof(bits));
+
+			// negative values have their magnitude reversed, positive ones go after them
+			const std::uint64_t sign = std::uint64_t(1) << 63;
+			bits = (bits & sign) ? ~bits : bits ^ sign;
+			writeBigEndian(bits, sizeof(bits), out);
+			return sizeof(bits);
+		}
+		default: {
+			// the terminating zeros make a string sort before every longer string it is a prefix of
+			const char *chars = reinterpret_cast<const char*>(value);
+			std::size_t length = strnlen(chars, attribute.length);
+			memcpy(out, chars, length);
+			memset(out + length, 0, attribute.length - length);
+			return attribute.length;
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::CompositeIndex -- Constructor
+// -----------------------------------------------------------------------------
+
+CompositeIndex::CompositeIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const std::vector<CompositeAttribute> & attributes)
+{
+	bufMgr = bufMgrIn;
+	CompositeIndex::relationName = relationName;
+	CompositeIndex::attributes = attributes;
+	rootPageNum = Page::INVALID_NUMBER;
+	height = 0;
+	numEntries = 0;
+	scanExecuting = false;
+	nextEntry = 0;
+	currentPageNum = Page::INVALID_NUMBER;
+	currentPageData = NULL;
+	highOp = LTE;
+
+	if(attributes.empty() || attributes.size() > static_cast<std::size_t>(COMPOSITEMAXATTRS))
+		throw BadIndexInfoException("a composite key needs between 1 and 4 attributes");
+
+	keyLength = 0;
+	std::ostringstream idxStr;
+	idxStr << relationName;
+	for(std::size_t i = 0; i < attributes.size(); i++) {
+		if(attributes[i].attrType == STRING && attributes[i].length <= 0)
+			throw BadIndexInfoException("a string attribute needs a length");
+		keyLength += attributeLength(attributes[i]);
+		idxStr << (i == 0 ? '.' : '_') << attributes[i].attrByteOffset;
+	}
+	if(keyLength > COMPOSITEKEYSIZE)
+		throw BadIndexInfoException("the attributes don't fit in a composite key");
+
+	idxStr << ".composite";
+	std::string indexName = idxStr.str(); // indexName is the name of the index file
+	outIndexName = indexName;
+
+	if(openIndexFile(indexName)) {
+		std::cout << "Index file " << indexName << " opened." << std::endl;
+		return;
+	}
+
+	createIndexFile(indexName);
+	buildIndex();
+}
+
+bool CompositeIndex::openIndexFile(const std::string & indexName)
+{
+	try {
+		file = new BlobFile(indexName, false);
+	}
+	catch(FileNotFoundException const&) {
+		// index file doesn't already exist
+		return false;
+	}
+
+	headerPageNum = file->getFirstPageNo();
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	CompositeMetaInfo metaInfo = *reinterpret_cast<CompositeMetaInfo*>(metaPage);
+	bufMgr->unPinPage(file, headerPageNum, false);
+
+	// the file has to describe the index asked for
+	std::string reason;
+	if(strncmp(metaInfo.relationName, relationName.c_str(), sizeof(metaInfo.relationName) - 1) != 0)
+		reason = "relation name does not match";
+	else if(metaInfo.attrCount != static_cast<int>(attributes.size()))
+		reason = "number of attributes does not match";
+	for(std::size_t i = 0; reason.empty() && i < attributes.size(); i++) {
+		const CompositeAttribute & attribute = metaInfo.attributes[i];
+		if(attribute.attrByteOffset != attributes[i].attrByteOffset)
+			reason = "attribute byte offset does not match";
+		else if(attribute.attrType != attributes[i].attrType)
+			reason = "attribute type does not match";
+		else if(attribute.attrType == STRING && attribute.length != attributes[i].length)
+			reason = "attribute length does not match";
+	}
+
+	if(!reason.empty()) {
+		bufMgr->flushFile(file);
+		delete file;
+		throw BadIndexInfoException(reason);
+	}
+
+	// rebuild if the relation changed since the index was built
+	PageId pageCount;
+	std::int64_t modTime;
+	if(!readRelationMarker(relationName, pageCount, modTime) ||
+			pageCount != metaInfo.relationPageCount || modTime != metaInfo.relationModTime) {
+		bufMgr->flushFile(file);
+		delete file;
+		File::remove(indexName);
+		return false;
+	}
+
+	// new nodes continue the runs of the extents instead of starting new ones
+	for(int i = 0; i < BlobFile::EXTENT_COUNT; i++) {
+		file->restoreExtent(i, metaInfo.extents[i]);
+	}
+
+	rootPageNum = metaInfo.rootPageNo;
+	height = metaInfo.height;
+	numEntries = metaInfo.numEntries;
+	return true;
+}
+
+void CompositeIndex::createIndexFile(const std::string & indexName)
+{
+	file = new BlobFile(indexName, true);
+
+	Page *metaPage;
+	bufMgr->allocPage(file, headerPageNum, metaPage);
+	Page *rootPage;
+	bufMgr->allocPage(file, rootPageNum, rootPage, LEAFEXTENT);
+	CompositeLeafNode *root = reinterpret_cast<CompositeLeafNode*>(rootPage);
+	memset(root, 0, Page::SIZE);
+	root->rightSibPageNo = Page::INVALID_NUMBER;
+
+	CompositeMetaInfo *metaInfo = reinterpret_cast<CompositeMetaInfo*>(metaPage);
+	memset(metaInfo, 0, Page::SIZE);
+	strncpy(metaInfo->relationName, relationName.c_str(), sizeof(metaInfo->relationName) - 1);
+	metaInfo->attrCount = static_cast<int>(attributes.size());
+	std::copy(attributes.begin(), attributes.end(), metaInfo->attributes);
+
+	bufMgr->unPinPage(file, headerPageNum, true);
+	bufMgr->unPinPage(file, rootPageNum, true);
+	writeMeta();
+}
+
+void CompositeIndex::buildIndex()
+{
+	{
+		FileScan scan(relationName, bufMgr);
+		try {
+			RecordId nextRec;
+			CompositeKey key;
+
+			while(true) {
+				scan.scanNext(nextRec);
+				std::string recordStr = scan.getRecord();
+				encodeRecord(recordStr.c_str(), key);
+				insertEntry(key, nextRec);
+			}
+		}
+		catch(EndOfFileException const&) {
+			std::cout << "Initial file scan of " << file->filename() << " finished." << std::endl;
+		}
+	}
+
+	writeMeta();
+
+	// remember which state of the relation the index reflects
+	PageId pageCount = 0;
+	std::int64_t modTime = 0;
+	readRelationMarker(relationName, pageCount, modTime);
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	CompositeMetaInfo *metaInfo = reinterpret_cast<CompositeMetaInfo*>(metaPage);
+	metaInfo->relationPageCount = pageCount;
+	metaInfo->relationModTime = modTime;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+void CompositeIndex::writeMeta()
+{
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	CompositeMetaInfo *metaInfo = reinterpret_cast<CompositeMetaInfo*>(metaPage);
+	metaInfo->rootPageNo = rootPageNum;
+	metaInfo->height = height;
+	metaInfo->numEntries = numEntries;
+	for(int i = 0; i < BlobFile::EXTENT_COUNT; i++) {
+		metaInfo->extents[i] = file->getExtent(i);
+	}
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::~CompositeIndex -- destructor
+// -----------------------------------------------------------------------------
+
+CompositeIndex::~CompositeIndex()
+{
+	try {
+		if(scanExecuting) {
+			endScan();
+		}
+		writeMeta();
+		bufMgr->flushFile(file);
+	}
+	catch(BadgerDbException const&) {
+		// the destructor must not throw
+	}
+
+	delete file;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::encodeRecord
+// -----------------------------------------------------------------------------
+
+void CompositeIndex::encodeRecord(const char *record, CompositeKey & key) const
+{
+	memset(key.bytes, 0, sizeof(key.bytes));
+	unsigned char *out = key.bytes;
+	for(std::size_t i = 0; i < attributes.size(); i++) {
+		out += encodeAttribute(attributes[i], record + attributes[i].attrByteOffset, out);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::encodeValues
+// -----------------------------------------------------------------------------
+
+void CompositeIndex::encodeValues(const std::vector<const void*> & values, CompositeKey & key, bool high) const
+{
+	memset(key.bytes, 0, sizeof(key.bytes));
+	unsigned char *out = key.bytes;
+	for(std::size_t i = 0; i < attributes.size() && i < values.size(); i++) {
+		out += encodeAttribute(attributes[i], values[i], out);
+	}
+
+	// all ones is above every encoded value, all zeros below or equal to them
+	if(high) {
+		memset(out, 0xFF, key.bytes + keyLength - out);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+void CompositeIndex::insertEntry(const CompositeKey & key, const RecordId rid)
+{
+	CompositeKey splitKey;
+	PageId splitPageNum;
+	if(insertIntoNode(rootPageNum, height, key, rid, splitKey, splitPageNum)) {
+		// the root was split, the tree grows a level
+		PageId newRootPageNum;
+		Page *newRootPage;
+		bufMgr->allocPage(file, newRootPageNum, newRootPage, NONLEAFEXTENT);
+		CompositeNonLeafNode *newRoot = reinterpret_cast<CompositeNonLeafNode*>(newRootPage);
+		memset(newRoot, 0, Page::SIZE);
+		newRoot->count = 1;
+		newRoot->keyArray[0] = splitKey;
+		newRoot->pageNoArray[0] = rootPageNum;
+		newRoot->pageNoArray[1] = splitPageNum;
+		bufMgr->unPinPage(file, newRootPageNum, true);
+
+		rootPageNum = newRootPageNum;
+		height++;
+		writeMeta();
+	}
+	numEntries++;
+}
+
+bool CompositeIndex::insertIntoNode(PageId pageNum, int levels, const CompositeKey & key, const RecordId & rid,
+		CompositeKey & splitKey, PageId & splitPageNum)
+{
+	Page *page;
+	bufMgr->readPage(file, pageNum, page);
+
+	if(levels == 0) {
+		CompositeLeafNode *leaf = reinterpret_cast<CompositeLeafNode*>(page);
+
+		// equal keys keep the order they were inserted in
+		int slot = static_cast<int>(std::upper_bound(leaf->keyArray, leaf->keyArray + leaf->count, key, keyLess) - leaf->keyArray);
+		bool split = leaf->count == COMPOSITELEAFSIZE;
+		if(split) {
+			Page *newPage;
+			bufMgr->allocPage(file, splitPageNum, newPage, LEAFEXTENT);
+			CompositeLeafNode *newLeaf = reinterpret_cast<CompositeLeafNode*>(newPage);
+			memset(newLeaf, 0, Page::SIZE);
+
+			// the upper half moves to a new right sibling
+			int half = leaf->count / 2;
+			newLeaf->count = leaf->count - half;
+			std::copy(leaf->keyArray + half, leaf->keyArray + leaf->count, newLeaf->keyArray);
+			std::copy(leaf->ridArray + half, leaf->ridArray + leaf->count, newLeaf->ridArray);
+			newLeaf->rightSibPageNo = leaf->rightSibPageNo;
+			leaf->rightSibPageNo = splitPageNum;
+			leaf->count = half;
+			splitKey = newLeaf->keyArray[0];
+
+			if(slot > half) {
+				bufMgr->unPinPage(file, pageNum, true);
+				pageNum = splitPageNum;
+				leaf = newLeaf;
+				slot -= half;
+			}
+			else {
+				bufMgr->unPinPage(file, splitPageNum, true);
+			}
+		}
+
+		std::copy_backward(leaf->keyArray + slot, leaf->keyArray + leaf->count, leaf->keyArray + leaf->count + 1);
+		std::copy_backward(leaf->ridArray + slot, leaf->ridArray + leaf->count, leaf->ridArray + leaf->count + 1);
+		leaf->keyArray[slot] = key;
+		leaf->ridArray[slot] = rid;
+		leaf->count++;
+		bufMgr->unPinPage(file, pageNum, true);
+		return split;
+	}
+
+	CompositeNonLeafNode *node = reinterpret_cast<CompositeNonLeafNode*>(page);
+	int child = static_cast<int>(std::upper_bound(node->keyArray, node->keyArray + node->count, key, keyLess) - node->keyArray);
+	PageId childPageNum = node->pageNoArray[child];
+	bufMgr->unPinPage(file, pageNum, false);
+
+	CompositeKey childSplitKey;
+	PageId childSplitPageNum;
+	if(!insertIntoNode(childPageNum, levels - 1, key, rid, childSplitKey, childSplitPageNum)) {
+		return false;
+	}
+
+	bufMgr->readPage(file, pageNum, page);
+	node = reinterpret_cast<CompositeNonLeafNode*>(page);
+	bool split = node->count == COMPOSITENONLEAFSIZE;
+	if(split) {
+		Page *newPage;
+		bufMgr->allocPage(file, splitPageNum, newPage, NONLEAFEXTENT);
+		CompositeNonLeafNode *newNode = reinterpret_cast<CompositeNonLeafNode*>(newPage);
+		memset(newNode, 0, Page::SIZE);
+
+		// the middle key moves up, the keys and children after it to a new right sibling
+		int middle = node->count / 2;
+		splitKey = node->keyArray[middle];
+		newNode->count = node->count - middle - 1;
+		std::copy(node->keyArray + middle + 1, node->keyArray + node->count, newNode->keyArray);
+		std::copy(node->pageNoArray + middle + 1, node->pageNoArray + node->count + 1, newNode->pageNoArray);
+		node->count = middle;
+
+		if(child > middle) {
+			bufMgr->unPinPage(file, pageNum, true);
+			pageNum = splitPageNum;
+			node = newNode;
+			child -= middle + 1;
+		}
+		else {
+			bufMgr->unPinPage(file, splitPageNum, true);
+		}
+	}
+
+	// the new child goes right after the one that was split
+	std::copy_backward(node->keyArray + child, node->keyArray + node->count, node->keyArray + node->count + 1);
+	std::copy_backward(node->pageNoArray + child + 1, node->pageNoArray + node->count + 1, node->pageNoArray + node->count + 2);
+	node->keyArray[child] = childSplitKey;
+	node->pageNoArray[child + 1] = childSplitPageNum;
+	node->count++;
+	bufMgr->unPinPage(file, pageNum, true);
+	return split;
+}
+
+PageId CompositeIndex::findLeaf(const CompositeKey & key)
+{
+	// equal keys may be on both sides of a separator, so descend left of any separator equal to the key
+	PageId pageNum = rootPageNum;
+	for(int levels = height; levels > 0; levels--) {
+		Page *page;
+		bufMgr->readPage(file, pageNum, page);
+		CompositeNonLeafNode *node = reinterpret_cast<CompositeNonLeafNode*>(page);
+		int child = static_cast<int>(std::lower_bound(node->keyArray, node->keyArray + node->count, key, keyLess) - node->keyArray);
+		PageId childPageNum = node->pageNoArray[child];
+		bufMgr->unPinPage(file, pageNum, false);
+		pageNum = childPageNum;
+	}
+	return pageNum;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::startScan
+// -----------------------------------------------------------------------------
+
+void CompositeIndex::startScan(const CompositeKey & lowKey,
+				   const Operator lowOpParm,
+				   const CompositeKey & highKey,
+				   const Operator highOpParm)
+{
+	if(lowOpParm != Operator::GT && lowOpParm != Operator::GTE) throw BadOpcodesException();
+	if(highOpParm != Operator::LT && highOpParm != Operator::LTE) throw BadOpcodesException();
+	if(keyLess(highKey, lowKey)) throw BadScanrangeException();
+
+	// only one scan at a time
+	if(scanExecuting) {
+		endScan();
+	}
+
+	CompositeIndex::highKey = highKey;
+	highOp = highOpParm;
+	currentPageNum = findLeaf(lowKey);
+	bufMgr->readPage(file, currentPageNum, currentPageData);
+
+	// the first qualifying entry may be in a right sibling
+	while(true)
+	{
+		CompositeLeafNode *leaf = reinterpret_cast<CompositeLeafNode*>(currentPageData);
+		CompositeKey *slot = lowOpParm == Operator::GTE
+			? std::lower_bound(leaf->keyArray, leaf->keyArray + leaf->count, lowKey, keyLess)
+			: std::upper_bound(leaf->keyArray, leaf->keyArray + leaf->count, lowKey, keyLess);
+		nextEntry = static_cast<int>(slot - leaf->keyArray);
+		if(nextEntry < leaf->count) break;
+
+		PageId nextPage = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageData = NULL;
+		if(nextPage == Page::INVALID_NUMBER) throw NoSuchKeyFoundException();
+
+		currentPageNum = nextPage;
+		bufMgr->readPage(file, currentPageNum, currentPageData);
+	}
+
+	const CompositeKey & key = reinterpret_cast<CompositeLeafNode*>(currentPageData)->keyArray[nextEntry];
+	if(highOp == Operator::LT ? !keyLess(key, highKey) : keyLess(highKey, key)) {
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageData = NULL;
+		throw NoSuchKeyFoundException();
+	}
+
+	scanExecuting = true;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::scanNext
+// -----------------------------------------------------------------------------
+
+void CompositeIndex::scanNext(RecordId& outRid)
+{
+	if(!scanExecuting) throw ScanNotInitializedException();
+	if(currentPageData == NULL) throw IndexScanCompletedException();
+
+	CompositeLeafNode *leaf = reinterpret_cast<CompositeLeafNode*>(currentPageData);
+	while(nextEntry == leaf->count)
+	{
+		// the last page stays pinned until endScan
+		PageId nextPage = leaf->rightSibPageNo;
+		if(nextPage == Page::INVALID_NUMBER) throw IndexScanCompletedException();
+
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageNum = nextPage;
+		bufMgr->readPage(file, currentPageNum, currentPageData);
+		leaf = reinterpret_cast<CompositeLeafNode*>(currentPageData);
+		nextEntry = 0;
+	}
+
+	const CompositeKey & key = leaf->keyArray[nextEntry];
+	if(highOp == Operator::LT ? !keyLess(key, highKey) : keyLess(highKey, key)) throw IndexScanCompletedException();
+
+	outRid = leaf->ridArray[nextEntry];
+	nextEntry++;
+}
+
+// -----------------------------------------------------------------------------
+// CompositeIndex::endScan
+// -----------------------------------------------------------------------------
+
+void CompositeIndex::endScan()
+{
+	if(!scanExecuting) throw ScanNotInitializedException();
+
+	if(currentPageData != NULL) {
+		bufMgr->unPinPage(file, currentPageNum, false);
+	}
+	currentPageData = NULL;
+	currentPageNum = Page::INVALID_NUMBER;
+	scanExecuting = false;
+}
+
+}
@@ -0,0 +1,407 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of bytes of a normalized composite key. Keys shorter than this are padded with zeros.
+ */
+const int COMPOSITEKEYSIZE = 32;
+
+/**
+ * @brief Maximum number of attributes in a composite key.
+ */
+const int COMPOSITEMAXATTRS = 4;
+
+/**
+ * @brief A composite key in normalized form. Two keys compare like the tuples of attribute values
+ * they were encoded from when compared byte by byte with memcmp, whatever the types of the attributes.
+ */
+struct CompositeKey{
+  /**
+   * Encoded attribute values, one after another, followed by zero padding.
+   */
+	unsigned char bytes[ COMPOSITEKEYSIZE ];
+};
+
+/**
+ * @brief Number of key slots in a leaf of a composite index.
+ */
+const int COMPOSITELEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( CompositeKey ) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of key slots in a non-leaf node of a composite index.
+ */
+const int COMPOSITENONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( CompositeKey ) + sizeof( PageId ) );
+
+/**
+ * @brief An attribute of a composite key: where it is in records, its type and, for strings, how
+ * many leading characters of it take part in the key.
+ */
+struct CompositeAttribute{
+  /**
+   * Offset of the attribute inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of characters of a STRING attribute in the key. Unused for INTEGER and DOUBLE attributes.
+   */
+	int length;
+};
+
+/**
+ * @brief The meta page, which holds metadata for the composite index, is always the first page of the index file and is cast
+ * to the following structure to store or retrieve information from it.
+ * Contains the relation name for which the index is created, the attributes of the key, the root of
+ * the tree and the state of the relation the index was built from.
+*/
+struct CompositeMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Number of attributes in the key.
+   */
+	int attrCount;
+
+  /**
+   * Attributes of the key, in the order they are compared.
+   */
+	CompositeAttribute attributes[ COMPOSITEMAXATTRS ];
+
+  /**
+   * Page number of root page of the B+ Tree inside the file index file.
+   */
+	PageId rootPageNo;
+
+  /**
+   * Number of non-leaf levels of the tree, 0 while the root is a leaf.
+   */
+	int height;
+
+  /**
+   * Number of entries in the index.
+   */
+	int numEntries;
+
+  /**
+   * Number of pages of the base relation when the index was built from it.
+   */
+	PageId relationPageCount;
+
+  /**
+   * Last modification time, in nanoseconds, of the base relation file when the index was built from it.
+   */
+	std::int64_t relationModTime;
+
+  /**
+   * Runs of pages the extents of the file were handing out when the meta page was last written, restored when the index is opened.
+   */
+	File::Extent extents[BlobFile::EXTENT_COUNT];
+};
+
+/**
+ * @brief Structure for the non-leaf nodes of a composite index.
+*/
+struct CompositeNonLeafNode{
+  /**
+   * Number of keys in the node.
+   */
+	int count;
+
+  /**
+   * Stores keys. Every key of the subtree at pageNoArray[i + 1] is greater than or equal to keyArray[i].
+   */
+	CompositeKey keyArray[ COMPOSITENONLEAFSIZE ];
+
+  /**
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+   */
+	PageId pageNoArray[ COMPOSITENONLEAFSIZE + 1 ];
+};
+
+/**
+ * @brief Structure for the leaves of a composite index.
+*/
+struct CompositeLeafNode{
+  /**
+   * Number of entries in the leaf.
+   */
+	int count;
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Stores keys.
+   */
+	CompositeKey keyArray[ COMPOSITELEAFSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ COMPOSITELEAFSIZE ];
+};
+
+static_assert(sizeof(CompositeMetaInfo) <= Page::SIZE && sizeof(CompositeNonLeafNode) <= Page::SIZE &&
+              sizeof(CompositeLeafNode) <= Page::SIZE,
+              "The meta page and the nodes of a composite index must each fit in one page.");
+
+/**
+ * @brief CompositeIndex class. It implements a B+ Tree index on several attributes of a relation.
+ * Keys are kept in normalized form: integers as big-endian with the sign bit flipped, doubles as
+ * big-endian with the sign bit flipped for positive values and every bit flipped for negative ones,
+ * and strings as their characters followed by zeros. Every comparison in the nodes is then a memcmp
+ * of fixed length, whatever the types of the attributes. This index supports only one scan at a time.
+*/
+class CompositeIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	BlobFile	*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Number of non-leaf levels of the tree, 0 while the root is a leaf.
+   */
+	int			height;
+
+  /**
+   * Name of the base relation.
+   */
+	std::string	relationName;
+
+  /**
+   * Attributes of the key, in the order they are compared.
+   */
+	std::vector<CompositeAttribute>	attributes;
+
+  /**
+   * Number of bytes of the encoded attributes in a key.
+   */
+	int			keyLength;
+
+  /**
+   * Number of entries in the index.
+   */
+	int			numEntries;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * True if an index scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned.
+   */
+	int			nextEntry;
+
+  /**
+   * Page number of current page being scanned.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current Page being scanned.
+   */
+	Page		*currentPageData;
+
+  /**
+   * High key of the scan.
+   */
+	CompositeKey	highKey;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+ public:
+
+  /**
+   * CompositeIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, validate its meta page against the parameters
+	 * and open the file without scanning the relation, unless the relation changed since the index was built.
+	 * If not, or if it is stale, create it and insert entries for every tuple in the base relation using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attributes					Attributes of the key, in the order they are compared
+   * @throws  BadIndexInfoException     If there are no attributes, too many, or their encoded values don't fit in a key, or if the index file already exists for the corresponding attributes, but values in metapage do not match with values received through constructor parameters.
+   */
+	CompositeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const std::vector<CompositeAttribute> & attributes);
+
+
+  /**
+   * CompositeIndex Destructor.
+	 * End any initialized scan, write the meta page, flush the index file and delete file instance thereby closing the index file.
+	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself.
+	 * */
+	~CompositeIndex();
+
+
+  /**
+	 * Encode the key of a record of the base relation.
+   * @param record	Record, as stored in pages
+   * @param key			Key of the record returned in this
+	**/
+	void encodeRecord(const char *record, CompositeKey & key) const;
+
+
+  /**
+	 * Encode a key from attribute values. Values may be given for the leading attributes only, the key
+	 * is then the lowest (or highest) one beginning with them, for scanning a range of key prefixes.
+   * @param values	Pointers to integer / double / char string values, one for each leading attribute
+   * @param key			Encoded key returned in this
+   * @param high		True to fill the attributes without a value with their highest value rather than their lowest
+	**/
+	void encodeValues(const std::vector<const void*> & values, CompositeKey & key, bool high = false) const;
+
+
+  /**
+	 * Insert a new entry using the pair <key,rid>.
+	 * Start from root to recursively find out the leaf to insert the entry in. The insertion may cause splitting of leaf node.
+	 * This splitting will require addition of new leaf page number entry into the parent non-leaf, which may in-turn get split.
+	 * This may continue all the way upto the root causing the root to get split. If root gets split, metapage needs to be changed accordingly.
+   * @param key			Encoded key to insert
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	void insertEntry(const CompositeKey & key, const RecordId rid);
+
+
+  /**
+	 * Begin a filtered scan of the index. Keys are compared as whole composite keys.
+   * @param lowKey	Low key of range
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highKey	High key of range
+   * @param highOp	High operator (LT/LTE)
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowKey > highKey
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	void startScan(const CompositeKey & lowKey, const Operator lowOp, const CompositeKey & highKey, const Operator highOp);
+
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan.
+	 * Return the next record from current page being scanned. If current page has been scanned to its entirety, move on to the right sibling of current page, if any exists, to start scanning that page. Make sure to unpin any pages that are no longer required.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	void scanNext(RecordId& outRid);
+
+
+  /**
+	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	void endScan();
+
+
+  /**
+	 * Returns the number of bytes of the encoded attributes in a key.
+	**/
+	int getKeyLength() const
+	{
+		return keyLength;
+	}
+
+  /**
+	 * Returns the number of entries in the index.
+	**/
+	int getNumEntries() const
+	{
+		return numEntries;
+	}
+
+ private:
+
+  /**
+   * Opens an existing index file.
+   * Returns false, leaving no file open, if the file doesn't exist or is stale and has been removed.
+   * @throws  BadIndexInfoException If the meta page doesn't match the parameters the index was constructed with.
+   */
+  bool openIndexFile(const std::string & indexName);
+
+  /**
+   * Creates a new index file holding the meta page and an empty root leaf.
+   */
+  void createIndexFile(const std::string & indexName);
+
+  /**
+   * Inserts entries for every tuple of the base relation, then records the state of the relation
+   * the index was built from in the meta page.
+   */
+  void buildIndex();
+
+  /**
+   * Writes the root, height and number of entries to the meta page.
+   */
+  void writeMeta();
+
+  /**
+   * Inserts an entry into the subtree rooted at a node, levels non-leaf levels above the leaves.
+   * Returns true if the node was split, along with the first key and the page of the new right node.
+   */
+  bool insertIntoNode(PageId pageNum, int levels, const CompositeKey & key, const RecordId & rid,
+                      CompositeKey & splitKey, PageId & splitPageNum);
+
+  /**
+   * Returns the leftmost leaf that may hold the key.
+   */
+  PageId findLeaf(const CompositeKey & key);
+};
+
+}
@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file can't be created or written
+ *        completely, e.g. because its directory is missing or the disk is full.
+ */
+class FileWriteException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a file write exception for the given file.
+   *
+   * @param name  Name of file that couldn't be written.
+   */
+  explicit FileWriteException(const std::string& name);
+
+  /**
+   * Returns the name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception. Kept by value, since the file is usually gone by the time it is caught.
+   */
+  const std::string filename_;
+};
+
+}
@@ -13,6 +13,8 @@
 #include <string>
 #include <cstdio>
 #include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
@@ -25,6 +27,9 @@ namespace badgerdb {
 
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::ExtentMap File::open_extents_;
+File::DescriptorMap File::open_descriptors_;
+const PageId BlobFile::EXTENT_PAGES;
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -59,12 +64,22 @@ File::~File() {
 }
 
 
+Page File::allocatePage(PageId &new_page_number, const int extent) {
+  return allocatePage(new_page_number);
+}
+
 PageId File::getFirstPageNo() {
   const FileHeader& header = readHeader();
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+void File::prefetchPages(const PageId first_page, const PageId count) const {
+  if (descriptor_ >= 0) {
+    posix_fadvise(descriptor_, pagePosition(first_page), static_cast<off_t>(count) * Page::SIZE, POSIX_FADV_WILLNEED);
+  }
+}
+
+File::File(const std::string& name, const bool create_new) : filename_(name), descriptor_(-1) {
   openIfNeeded(create_new);
 
   if (create_new) {
@@ -79,6 +94,7 @@ void File::openIfNeeded(const bool create_new) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    descriptor_ = open_descriptors_[filename_];
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -99,6 +115,10 @@ void File::openIfNeeded(const bool create_new) {
     stream_.reset(new std::fstream(filename_, mode));
     open_streams_[filename_] = stream_;
     open_counts_[filename_] = 1;
+
+    // the stream doesn't expose its descriptor, so one is opened next to it for the whole time it is open
+    descriptor_ = ::open(filename_.c_str(), O_RDWR);
+    open_descriptors_[filename_] = descriptor_;
   }
 }
 
@@ -107,11 +127,20 @@ void File::close() {
   	--open_counts_[filename_];
 
   stream_.reset();
+  descriptor_ = -1;
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
+    DescriptorMap::iterator descriptor = open_descriptors_.find(filename_);
+    if (descriptor != open_descriptors_.end()) {
+      if (descriptor->second >= 0) {
+        ::close(descriptor->second);
+      }
+      open_descriptors_.erase(descriptor);
+    }
     open_streams_.erase(filename_);
     open_counts_.erase(filename_);
+    open_extents_.erase(filename_);
   }
 }
 
@@ -361,21 +390,71 @@ BlobFile& BlobFile::operator=(const BlobFile& rhs) {
 }
 
 Page BlobFile::allocatePage(PageId &new_page_number) {
-  FileHeader header = readHeader();
-	Page new_page;
+  return allocatePage(new_page_number, 0);
+}
+
+Page BlobFile::allocatePage(PageId &new_page_number, const int extent) {
+	std::vector<Extent>& extents = open_extents_[filename_];
+	if (extents.empty()) {
+		Extent none = {0, 0};
+		extents.assign(EXTENT_COUNT, none);
+	}
+
+	// the run is already zero-filled on disk, so the page itself is not written
+	Extent& current = extents[extent];
+	if (current.next == current.end) {
+		current.next = reservePages(EXTENT_PAGES);
+		current.end = current.next + EXTENT_PAGES;
+	}
+	new_page_number = current.next++;
+
+	return Page();
+}
 
-	new_page_number = header.num_pages;
+PageId BlobFile::reservePages(const PageId count) {
+  FileHeader header = readHeader();
+	PageId first = header.num_pages;
 
 	if (header.first_used_page == Page::INVALID_NUMBER) {
-		header.first_used_page = header.num_pages;
+		header.first_used_page = first;
 	}
+	header.num_pages += count;
 
-	++header.num_pages;
+	// fallocate reserves the blocks in one go; without it the run is extended by writing its last page
+	bool reserved = descriptor_ >= 0 &&
+		posix_fallocate(descriptor_, pagePosition(first), static_cast<off_t>(count) * Page::SIZE) == 0;
+	if (!reserved) {
+		writePage(first + count - 1, Page());
+	}
 
-	writePage(new_page_number, new_page);
 	writeHeader(header);
+	return first;
+}
 
-	return new_page;
+File::Extent BlobFile::getExtent(const int extent) const {
+	ExtentMap::const_iterator extents = open_extents_.find(filename_);
+	if (extents == open_extents_.end() || extents->second.empty()) {
+		Extent none = {0, 0};
+		return none;
+	}
+	return extents->second[extent];
+}
+
+void BlobFile::restoreExtent(const int extent, const Extent& run) {
+	// a run past the end of the file wasn't saved by this file, so it is better left unused
+	FileHeader header = readHeader();
+	if (run.next >= run.end || run.next == 0 || run.end > header.num_pages) {
+		return;
+	}
+
+	std::vector<Extent>& extents = open_extents_[filename_];
+	if (extents.empty()) {
+		Extent none = {0, 0};
+		extents.assign(EXTENT_COUNT, none);
+	}
+	if (extents[extent].next == extents[extent].end) {
+		extents[extent] = run;
+	}
 }
 
 Page BlobFile::readPage(const PageId page_number) const {
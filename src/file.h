@@ -11,6 +11,7 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "page.h"
 
@@ -75,6 +76,21 @@ struct FileHeader {
 class File {
  public:
 
+  /**
+   * A run of pages reserved in a file and handed out one at a time.
+   */
+  struct Extent {
+    /**
+     * Next page to hand out.
+     */
+    PageId next;
+
+    /**
+     * Page after the last one of the run.
+     */
+    PageId end;
+  };
+
   /**
    * Constructs a file object representing a file on the filesystem.
    *
@@ -124,6 +140,16 @@ class File {
    */
   virtual Page allocatePage(PageId &new_page_number) = 0;
 
+  /**
+   * Allocates a new page in the file from one of several extents, for files that keep kinds of
+   * pages apart. Files without extents ignore it.
+   *
+   * @param new_page_number Number of the new page, returned.
+   * @param extent          Extent the page is allocated from.
+   * @return The new page.
+   */
+  virtual Page allocatePage(PageId &new_page_number, const int extent);
+
   /**
    * Reads an existing page from the file.
    *
@@ -164,6 +190,15 @@ class File {
    */
 	PageId getFirstPageNo();
 
+  /**
+   * Asks the operating system to start reading pages into its cache without waiting for them, so that
+   * reading them later doesn't block on the disk. This is only a hint and failures are ignored.
+   *
+   * @param first_page  Number of the first page to prefetch.
+   * @param count       Number of consecutive pages to prefetch.
+   */
+  void prefetchPages(const PageId first_page, const PageId count) const;
+
  protected:
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -212,6 +247,8 @@ class File {
 
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, std::vector<Extent> > ExtentMap;
+  typedef std::map<std::string, int> DescriptorMap;
 
   /**
    * Streams for opened files.
@@ -223,6 +260,17 @@ class File {
    */
   static CountMap open_counts_;
 
+  /**
+   * Extents of opened files that still have pages to hand out. They are dropped with the stream;
+   * files that keep the pages left in them save each extent before closing and restore it when opened.
+   */
+  static ExtentMap open_extents_;
+
+  /**
+   * Descriptors of opened files, for the calls the stream has no equivalent of. Closed with the stream.
+   */
+  static DescriptorMap open_descriptors_;
+
   /**
    * Name of the file this object represents.
    */
@@ -233,6 +281,11 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Descriptor of the underlying file, shared like the stream, -1 if it couldn't be opened.
+   */
+  int descriptor_;
+
   friend class FileIterator;
 };
 
@@ -449,12 +502,59 @@ class BlobFile : public File {
   ~BlobFile();
 
   /**
-   * Allocates a new page in the file.
+   * Number of pages reserved at once when an extent runs out.
+   */
+  static const PageId EXTENT_PAGES = 64;
+
+  /**
+   * Number of extents pages are allocated from, each growing separately.
+   */
+  static const int EXTENT_COUNT = 2;
+
+  /**
+   * Allocates a new page in the file, from extent 0.
    *
    * @return The new page.
    */
   Page allocatePage(PageId &new_page_number) override;
 
+  /**
+   * Allocates a new page from an extent. Pages of the same extent are handed out in order from runs of
+   * EXTENT_PAGES pages, reserved at the end of the file and zero-filled when the previous run is used up.
+   * Only reserving a run writes the header; allocating a page touches neither the header nor the page.
+   *
+   * @param new_page_number Number of the new page, returned.
+   * @param extent          Extent the page is allocated from, below EXTENT_COUNT.
+   * @return The new page.
+   */
+  Page allocatePage(PageId &new_page_number, const int extent) override;
+
+  /**
+   * Reserves consecutive pages at the end of the file, apart from every extent. The pages read as zeros
+   * until they are written, and are not handed out by allocatePage().
+   *
+   * @param count   Number of pages to reserve.
+   * @return  Number of the first page reserved.
+   */
+  PageId reservePages(const PageId count);
+
+  /**
+   * Returns the run of pages an extent is handing out, empty if it has none.
+   *
+   * @param extent  Extent, below EXTENT_COUNT.
+   */
+  Extent getExtent(const int extent) const;
+
+  /**
+   * Gives an extent back the run of pages getExtent() returned before the file was closed, so that its
+   * remaining pages are handed out again. Ignored if the extent already has a run, e.g. because the
+   * file is open elsewhere, or if the run isn't within the file.
+   *
+   * @param extent  Extent, below EXTENT_COUNT.
+   * @param run     Run saved by getExtent().
+   */
+  void restoreExtent(const int extent, const Extent& run);
+
   /**
    * Reads an existing page from the file.
    *
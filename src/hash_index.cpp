@@ -0,0 +1,474 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "hash_index.h"
+#include <algorithm>
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/badgerdb_exception.h"
+
+namespace badgerdb
+{
+
+std::uint32_t hashKey(int key)
+{
+	std::uint32_t hash = static_cast<std::uint32_t>(key);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bU;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35U;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::HashIndex -- Constructor
+// -----------------------------------------------------------------------------
+
+HashIndex::HashIndex(const std::string & relationName,
+		std::string & outIndexName,
+		BufMgr *bufMgrIn,
+		const int attrByteOffset,
+		const Datatype attrType)
+{
+	bufMgr = bufMgrIn;
+	HashIndex::relationName = relationName;
+	attributeType = attrType; // should just be INTEGER
+	HashIndex::attrByteOffset = attrByteOffset;
+	globalDepth = 0;
+	directoryPageNum = Page::INVALID_NUMBER;
+	directoryPageCount = 0;
+	numEntries = 0;
+	freePageNum = Page::INVALID_NUMBER;
+	freePageCount = 0;
+
+	std::ostringstream idxStr;
+	idxStr << relationName << '.' << attrByteOffset << ".hash";
+	std::string indexName = idxStr.str(); // indexName is the name of the index file
+	outIndexName = indexName;
+
+	if(openIndexFile(indexName)) {
+		std::cout << "Index file " << indexName << " opened." << std::endl;
+		return;
+	}
+
+	createIndexFile(indexName);
+	buildIndex();
+}
+
+bool HashIndex::openIndexFile(const std::string & indexName)
+{
+	try {
+		file = new BlobFile(indexName, false);
+	}
+	catch(FileNotFoundException const&) {
+		// index file doesn't already exist
+		return false;
+	}
+
+	headerPageNum = file->getFirstPageNo();
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	HashMetaInfo metaInfo = *reinterpret_cast<HashMetaInfo*>(metaPage);
+	bufMgr->unPinPage(file, headerPageNum, false);
+
+	// the file has to describe the index asked for
+	std::string reason;
+	if(strncmp(metaInfo.relationName, relationName.c_str(), sizeof(metaInfo.relationName) - 1) != 0)
+		reason = "relation name does not match";
+	else if(metaInfo.attrByteOffset != attrByteOffset)
+		reason = "attribute byte offset does not match";
+	else if(metaInfo.attrType != attributeType)
+		reason = "attribute type does not match";
+
+	if(!reason.empty()) {
+		bufMgr->flushFile(file);
+		delete file;
+		throw BadIndexInfoException(reason);
+	}
+
+	// rebuild if the relation changed since the index was built
+	PageId pageCount;
+	std::int64_t modTime;
+	if(!readRelationMarker(relationName, pageCount, modTime) ||
+			pageCount != metaInfo.relationPageCount || modTime != metaInfo.relationModTime) {
+		bufMgr->flushFile(file);
+		delete file;
+		File::remove(indexName);
+		return false;
+	}
+
+	// buckets allocated from now on continue the runs of the previous ones
+	for(int i = 0; i < BlobFile::EXTENT_COUNT; i++) {
+		file->restoreExtent(i, metaInfo.extents[i]);
+	}
+
+	globalDepth = metaInfo.globalDepth;
+	numEntries = metaInfo.numEntries;
+	freePageNum = metaInfo.freePageNo;
+	freePageCount = metaInfo.freePageCount;
+	directoryPageNum = metaInfo.directoryPageNo;
+	directoryPageCount = metaInfo.directoryPageCount;
+
+	int slots = 1 << globalDepth;
+	directory.resize(slots);
+	for(int i = 0; i * HASHDIRECTORYPERPAGE < slots; i++) {
+		int first = i * HASHDIRECTORYPERPAGE;
+		int count = std::min(HASHDIRECTORYPERPAGE, slots - first);
+
+		Page *directoryPage;
+		bufMgr->readPage(file, directoryPageNum + i, directoryPage);
+		memcpy(&directory[first], reinterpret_cast<PageId*>(directoryPage), count * sizeof(PageId));
+		bufMgr->unPinPage(file, directoryPageNum + i, false);
+	}
+	return true;
+}
+
+void HashIndex::createIndexFile(const std::string & indexName)
+{
+	file = new BlobFile(indexName, true);
+
+	// the meta page comes first, followed by the single bucket of a directory of depth 0
+	Page *metaPage;
+	bufMgr->allocPage(file, headerPageNum, metaPage);
+	PageId bucketPageNum;
+	Page *bucketPage;
+	bufMgr->allocPage(file, bucketPageNum, bucketPage);
+	memset(reinterpret_cast<HashBucketInt*>(bucketPage), 0, Page::SIZE);
+	directory.assign(1, bucketPageNum);
+
+	HashMetaInfo *metaInfo = reinterpret_cast<HashMetaInfo*>(metaPage);
+	memset(metaInfo, 0, Page::SIZE);
+	strncpy(metaInfo->relationName, relationName.c_str(), sizeof(metaInfo->relationName) - 1);
+	metaInfo->attrByteOffset = attrByteOffset;
+	metaInfo->attrType = attributeType;
+
+	bufMgr->unPinPage(file, headerPageNum, true);
+	bufMgr->unPinPage(file, bucketPageNum, true);
+	writeDirectory();
+}
+
+void HashIndex::buildIndex()
+{
+	{
+		FileScan scan(relationName, bufMgr);
+		try {
+			RecordId nextRec;
+
+			while(true) {
+				scan.scanNext(nextRec);
+				std::string recordStr = scan.getRecord();
+				int key = *reinterpret_cast<const int*>(recordStr.c_str() + attrByteOffset);
+				insertEntry(&key, nextRec);
+			}
+		}
+		catch(EndOfFileException const&) {
+			std::cout << "Initial file scan of " << file->filename() << " finished." << std::endl;
+		}
+	}
+
+	writeDirectory();
+
+	// remember which state of the relation the index reflects
+	PageId pageCount = 0;
+	std::int64_t modTime = 0;
+	readRelationMarker(relationName, pageCount, modTime);
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	HashMetaInfo *metaInfo = reinterpret_cast<HashMetaInfo*>(metaPage);
+	metaInfo->relationPageCount = pageCount;
+	metaInfo->relationModTime = modTime;
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::~HashIndex -- destructor
+// -----------------------------------------------------------------------------
+
+HashIndex::~HashIndex()
+{
+	try {
+		writeDirectory();
+		bufMgr->flushFile(file);
+	}
+	catch(BadgerDbException const&) {
+		// the destructor must not throw
+	}
+
+	delete file;
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::insertEntry
+// -----------------------------------------------------------------------------
+
+void HashIndex::insertEntry(const void *key, const RecordId rid)
+{
+	int keyInt = *reinterpret_cast<const int*>(key);
+	std::uint32_t hash = hashKey(keyInt);
+
+	while(true)
+	{
+		std::size_t slot = directorySlot(hash);
+		PageId pageNum = directory[slot];
+		Page *page;
+		bufMgr->readPage(file, pageNum, page);
+		HashBucketInt *bucket = reinterpret_cast<HashBucketInt*>(page);
+
+		// a bucket full of the key being inserted can't be split apart, it grows overflow pages instead
+		bool split = bucket->count == INTHASHBUCKETSIZE && bucket->localDepth < HASHMAXGLOBALDEPTH;
+		if(split) {
+			split = false;
+			for(int i = 0; i < bucket->count; i++) {
+				if(bucket->keyArray[i] != keyInt) {
+					split = true;
+					break;
+				}
+			}
+		}
+		bufMgr->unPinPage(file, pageNum, false);
+
+		if(!split) {
+			appendEntry(pageNum, keyInt, rid);
+			numEntries++;
+			return;
+		}
+		splitBucket(slot);
+	}
+}
+
+std::size_t HashIndex::directorySlot(std::uint32_t hash) const
+{
+	return hash & ((std::uint32_t(1) << globalDepth) - 1);
+}
+
+void HashIndex::appendEntry(PageId pageNum, int key, const RecordId & rid)
+{
+	while(true)
+	{
+		Page *page;
+		bufMgr->readPage(file, pageNum, page);
+		HashBucketInt *bucket = reinterpret_cast<HashBucketInt*>(page);
+
+		if(bucket->count < INTHASHBUCKETSIZE) {
+			bucket->keyArray[bucket->count] = key;
+			bucket->ridArray[bucket->count] = rid;
+			bucket->count++;
+			bufMgr->unPinPage(file, pageNum, true);
+			return;
+		}
+
+		if(bucket->overflowPageNo == Page::INVALID_NUMBER) {
+			PageId overflowPageNum;
+			Page *overflowPage;
+			allocBucketPage(overflowPageNum, overflowPage);
+			HashBucketInt *overflow = reinterpret_cast<HashBucketInt*>(overflowPage);
+			overflow->keyArray[0] = key;
+			overflow->ridArray[0] = rid;
+			overflow->count = 1;
+
+			bucket->overflowPageNo = overflowPageNum;
+			bufMgr->unPinPage(file, overflowPageNum, true);
+			bufMgr->unPinPage(file, pageNum, true);
+			return;
+		}
+
+		PageId nextPage = bucket->overflowPageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		pageNum = nextPage;
+	}
+}
+
+void HashIndex::splitBucket(std::size_t slot)
+{
+	PageId oldPageNum = directory[slot];
+
+	// take every entry out of the bucket's chain and free its overflow pages
+	std::vector<int> keys;
+	std::vector<RecordId> rids;
+	Page *oldPage;
+	bufMgr->readPage(file, oldPageNum, oldPage);
+	HashBucketInt *oldBucket = reinterpret_cast<HashBucketInt*>(oldPage);
+	int depth = oldBucket->localDepth;
+
+	PageId pageNum = oldPageNum;
+	HashBucketInt *bucket = oldBucket;
+	while(true)
+	{
+		keys.insert(keys.end(), bucket->keyArray, bucket->keyArray + bucket->count);
+		rids.insert(rids.end(), bucket->ridArray, bucket->ridArray + bucket->count);
+		PageId nextPage = bucket->overflowPageNo;
+		if(pageNum != oldPageNum) freeBucketPage(pageNum, reinterpret_cast<Page*>(bucket));
+		if(nextPage == Page::INVALID_NUMBER) break;
+
+		pageNum = nextPage;
+		Page *page;
+		bufMgr->readPage(file, pageNum, page);
+		bucket = reinterpret_cast<HashBucketInt*>(page);
+	}
+
+	memset(oldBucket, 0, Page::SIZE);
+	oldBucket->localDepth = depth + 1;
+	bufMgr->unPinPage(file, oldPageNum, true);
+
+	PageId newPageNum;
+	Page *newPage;
+	allocBucketPage(newPageNum, newPage);
+	HashBucketInt *newBucket = reinterpret_cast<HashBucketInt*>(newPage);
+	newBucket->localDepth = depth + 1;
+	bufMgr->unPinPage(file, newPageNum, true);
+
+	// a bucket used by a single slot needs another hash bit, and so twice the slots
+	if(depth == globalDepth) {
+		directory.insert(directory.end(), directory.begin(), directory.end());
+		globalDepth++;
+	}
+
+	// slots of the old bucket with the next hash bit set move to the new one
+	for(std::size_t i = 0; i < directory.size(); i++) {
+		if(directory[i] == oldPageNum && ((i >> depth) & 1)) {
+			directory[i] = newPageNum;
+		}
+	}
+
+	for(std::size_t i = 0; i < keys.size(); i++) {
+		bool high = (hashKey(keys[i]) >> depth) & 1;
+		appendEntry(high ? newPageNum : oldPageNum, keys[i], rids[i]);
+	}
+}
+
+void HashIndex::allocBucketPage(PageId & pageNum, Page *& page)
+{
+	if(freePageNum == Page::INVALID_NUMBER) {
+		bufMgr->allocPage(file, pageNum, page);
+	}
+	else {
+		pageNum = freePageNum;
+		bufMgr->readPage(file, pageNum, page);
+		freePageNum = reinterpret_cast<HashBucketInt*>(page)->overflowPageNo;
+		freePageCount--;
+	}
+	memset(reinterpret_cast<char*>(page), 0, Page::SIZE);
+}
+
+void HashIndex::freeBucketPage(PageId pageNum, Page *page)
+{
+	HashBucketInt *bucket = reinterpret_cast<HashBucketInt*>(page);
+	memset(bucket, 0, Page::SIZE);
+	bucket->overflowPageNo = freePageNum;
+	freePageNum = pageNum;
+	freePageCount++;
+	bufMgr->unPinPage(file, pageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::lookup
+// -----------------------------------------------------------------------------
+
+void HashIndex::lookup(const void *key, std::vector<RecordId>& outRids)
+{
+	int keyInt = *reinterpret_cast<const int*>(key);
+	outRids.clear();
+
+	PageId pageNum = directory[directorySlot(hashKey(keyInt))];
+	while(pageNum != Page::INVALID_NUMBER)
+	{
+		Page *page;
+		bufMgr->readPage(file, pageNum, page);
+		HashBucketInt *bucket = reinterpret_cast<HashBucketInt*>(page);
+		for(int i = 0; i < bucket->count; i++) {
+			if(bucket->keyArray[i] == keyInt) outRids.push_back(bucket->ridArray[i]);
+		}
+
+		PageId nextPage = bucket->overflowPageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		pageNum = nextPage;
+	}
+
+	if(outRids.empty()) throw NoSuchKeyFoundException();
+}
+
+// -----------------------------------------------------------------------------
+// HashIndex::deleteEntry
+// -----------------------------------------------------------------------------
+
+void HashIndex::deleteEntry(const void *key, const RecordId rid)
+{
+	int keyInt = *reinterpret_cast<const int*>(key);
+
+	PageId pageNum = directory[directorySlot(hashKey(keyInt))];
+	while(pageNum != Page::INVALID_NUMBER)
+	{
+		Page *page;
+		bufMgr->readPage(file, pageNum, page);
+		HashBucketInt *bucket = reinterpret_cast<HashBucketInt*>(page);
+		for(int i = 0; i < bucket->count; i++) {
+			if(bucket->keyArray[i] != keyInt || bucket->ridArray[i] != rid) continue;
+
+			// entries are unordered, so the last one fills the gap
+			int last = bucket->count - 1;
+			bucket->keyArray[i] = bucket->keyArray[last];
+			bucket->ridArray[i] = bucket->ridArray[last];
+			bucket->keyArray[last] = 0;
+			memset(&bucket->ridArray[last], 0, sizeof(RecordId));
+			bucket->count--;
+			bufMgr->unPinPage(file, pageNum, true);
+			numEntries--;
+			return;
+		}
+
+		PageId nextPage = bucket->overflowPageNo;
+		bufMgr->unPinPage(file, pageNum, false);
+		pageNum = nextPage;
+	}
+
+	throw NoSuchKeyFoundException();
+}
+
+void HashIndex::writeDirectory()
+{
+	int slots = static_cast<int>(directory.size());
+	int pageCount = (slots + HASHDIRECTORYPERPAGE - 1) / HASHDIRECTORYPERPAGE;
+
+	// a directory that outgrew its pages moves to a new run of consecutive pages
+	if(pageCount > directoryPageCount) {
+		directoryPageNum = file->reservePages(pageCount);
+		directoryPageCount = pageCount;
+	}
+
+	for(int i = 0; i < pageCount; i++) {
+		int first = i * HASHDIRECTORYPERPAGE;
+		int count = std::min(HASHDIRECTORYPERPAGE, slots - first);
+
+		Page *directoryPage;
+		bufMgr->readPage(file, directoryPageNum + i, directoryPage);
+		PageId *pageIds = reinterpret_cast<PageId*>(directoryPage);
+		memset(pageIds, 0, Page::SIZE);
+		memcpy(pageIds, &directory[first], count * sizeof(PageId));
+		bufMgr->unPinPage(file, directoryPageNum + i, true);
+	}
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	HashMetaInfo *metaInfo = reinterpret_cast<HashMetaInfo*>(metaPage);
+	metaInfo->globalDepth = globalDepth;
+	metaInfo->directoryPageNo = directoryPageNum;
+	metaInfo->directoryPageCount = directoryPageCount;
+	metaInfo->numEntries = numEntries;
+	metaInfo->freePageNo = freePageNum;
+	metaInfo->freePageCount = freePageCount;
+	for(int i = 0; i < BlobFile::EXTENT_COUNT; i++) {
+		metaInfo->extents[i] = file->getExtent(i);
+	}
+	bufMgr->unPinPage(file, headerPageNum, true);
+}
+
+}
@@ -0,0 +1,353 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of entries that fit in a bucket page of a hash index on an integer attribute.
+ */
+const int INTHASHBUCKETSIZE = ( Page::SIZE - 2 * sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of directory slots held by a page of a hash index file.
+ */
+const int HASHDIRECTORYPERPAGE = Page::SIZE / sizeof( PageId );
+
+/**
+ * @brief Maximum global depth of a hash index. A full bucket at this depth gets overflow pages instead of being split.
+ */
+const int HASHMAXGLOBALDEPTH = 24;
+
+/**
+ * @brief Mixes the bits of a key (the finalizer of MurmurHash3). The mix is a bijection, so distinct keys never share
+ * a hash. A bucket of local depth d holds the keys whose hashes share its low d bits.
+ */
+std::uint32_t hashKey(int key);
+
+/**
+ * @brief The meta page, which holds metadata for the hash index, is always the first page of the index file and is cast
+ * to the following structure to store or retrieve information from it.
+ * Contains the relation name for which the index is created, the byte offset
+ * of the key value on which the index is made, the type of the key, the directory and
+ * the state of the relation the index was built from.
+*/
+struct HashMetaInfo{
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of low hash bits that select a directory slot; the directory has 2^globalDepth slots.
+   */
+	int globalDepth;
+
+  /**
+   * First of the consecutive pages holding the directory.
+   */
+	PageId directoryPageNo;
+
+  /**
+   * Number of pages allocated to the directory.
+   */
+	int directoryPageCount;
+
+  /**
+   * Number of entries in the index.
+   */
+	int numEntries;
+
+  /**
+   * Number of pages of the base relation when the index was built from it.
+   */
+	PageId relationPageCount;
+
+  /**
+   * Last modification time, in nanoseconds, of the base relation file when the index was built from it.
+   */
+	std::int64_t relationModTime;
+
+  /**
+   * Runs of pages the extents of the file were handing out when the directory was last written, restored when the index is opened.
+   */
+	File::Extent extents[BlobFile::EXTENT_COUNT];
+
+  /**
+   * First page of the chain of free bucket pages, 0 if there is none. They are linked through overflowPageNo.
+   */
+	PageId freePageNo;
+
+  /**
+   * Number of pages in the chain of free bucket pages.
+   */
+	int freePageCount;
+};
+
+/**
+ * @brief Structure for the bucket pages of a hash index on an integer attribute.
+ * Entries are unordered and packed at the front. A bucket holding nothing but one key that
+ * outgrows its page continues in a chain of overflow pages of the same structure.
+*/
+struct HashBucketInt{
+  /**
+   * Number of low hash bits shared by every key in the bucket. Unused in overflow pages.
+   */
+	int localDepth;
+
+  /**
+   * Number of entries in this page.
+   */
+	int count;
+
+  /**
+   * Stores keys.
+   */
+	int keyArray[ INTHASHBUCKETSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ INTHASHBUCKETSIZE ];
+
+  /**
+   * Page number of the next overflow page, 0 if there is none. In a free page, the next free page.
+   */
+	PageId overflowPageNo;
+};
+
+static_assert(sizeof(HashBucketInt) <= Page::SIZE,
+              "A hash bucket must fit in one page.");
+
+/**
+ * @brief HashIndex class. It implements an extendible hash index on a single attribute of a
+ * relation, for equality lookups. Keys are hashed by a bijective mix, so distinct keys always
+ * end up in different buckets once enough hash bits are used.
+*/
+class HashIndex {
+
+ private:
+
+  /**
+   * File object for the index file.
+   */
+	BlobFile	*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * Name of the base relation.
+   */
+	std::string	relationName;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records.
+   */
+	int			attrByteOffset;
+
+  /**
+   * Number of low hash bits that select a directory slot.
+   */
+	int			globalDepth;
+
+  /**
+   * Bucket page of every directory slot. Buckets with a local depth below globalDepth are shared by several slots.
+   */
+	std::vector<PageId>	directory;
+
+  /**
+   * First page of the directory in the index file.
+   */
+	PageId	directoryPageNum;
+
+  /**
+   * Number of pages allocated to the directory.
+   */
+	int			directoryPageCount;
+
+  /**
+   * Number of entries in the index.
+   */
+	int			numEntries;
+
+  /**
+   * First page of the chain of free bucket pages, Page::INVALID_NUMBER if there is none.
+   */
+	PageId	freePageNum;
+
+  /**
+   * Number of pages in the chain of free bucket pages.
+   */
+	int			freePageCount;
+
+ public:
+
+  /**
+   * HashIndex Constructor.
+	 * Check to see if the corresponding index file exists. If so, validate its meta page against the parameters
+	 * and open the file without scanning the relation, unless the relation changed since the index was built.
+	 * If not, or if it is stale, create it and insert entries for every tuple in the base relation using FileScan class.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
+   * @param attrType						Datatype of attribute over which index is built
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   */
+	HashIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+
+
+  /**
+   * HashIndex Destructor.
+	 * Write out the directory and meta page, flush the index file and delete file instance thereby closing the index file.
+	 * Destructor should not throw any exceptions. All exceptions should be caught in here itself.
+	 * */
+	~HashIndex();
+
+
+  /**
+	 * Insert a new entry using the pair <value,rid>.
+	 * A full bucket is split, doubling the directory if its local depth equals the global depth, until the entry fits.
+   * @param key			Key to insert, pointer to integer/double/char string
+   * @param rid			Record ID of a record whose entry is getting inserted into the index.
+	**/
+	void insertEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Find the record ids of all entries with the key.
+   * @param key			Key to look up, pointer to integer/double/char string
+   * @param outRids	Record IDs of the entries with the key, in no particular order.
+	 * @throws  NoSuchKeyFoundException If the index holds no entry for the key.
+	**/
+	void lookup(const void* key, std::vector<RecordId>& outRids);
+
+
+  /**
+	 * Delete the entry for the pair <value,rid>. Buckets are not merged and the directory never shrinks.
+   * @param key			Key to delete, pointer to integer/double/char string
+   * @param rid			Record ID of the record whose entry is deleted.
+	 * @throws  NoSuchKeyFoundException If the index holds no entry for the pair.
+	**/
+	void deleteEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Returns the number of low hash bits that select a directory slot.
+	**/
+	int getGlobalDepth() const
+	{
+		return globalDepth;
+	}
+
+  /**
+	 * Returns the number of entries in the index.
+	**/
+	int getNumEntries() const
+	{
+		return numEntries;
+	}
+
+  /**
+	 * Returns the number of pages freed by splits that new buckets and overflow pages haven't taken yet.
+	**/
+	int getFreePageCount() const
+	{
+		return freePageCount;
+	}
+
+ private:
+
+  /**
+   * Opens an existing index file and loads the directory from it.
+   * Returns false, leaving no file open, if the file doesn't exist or is stale and has been removed.
+   * @throws  BadIndexInfoException If the meta page doesn't match the parameters the index was constructed with.
+   */
+  bool openIndexFile(const std::string & indexName);
+
+  /**
+   * Creates a new index file holding the meta page and one empty bucket.
+   */
+  void createIndexFile(const std::string & indexName);
+
+  /**
+   * Inserts entries for every tuple of the base relation, then records the state of the relation
+   * the index was built from in the meta page.
+   */
+  void buildIndex();
+
+  /**
+   * Returns the directory slot of a hashed key.
+   */
+  std::size_t directorySlot(std::uint32_t hash) const;
+
+  /**
+   * Adds an entry to the first page of the bucket's chain with room, appending an overflow page if they are all full.
+   */
+  void appendEntry(PageId pageNum, int key, const RecordId & rid);
+
+  /**
+   * Splits the bucket of a directory slot in two by the next hash bit, doubling the directory first if needed.
+   * The overflow pages of the bucket are freed, so that its entries and the new bucket take them again.
+   */
+  void splitBucket(std::size_t slot);
+
+  /**
+   * Allocates an empty bucket page, taking the first free page if there is one, and leaves it pinned.
+   */
+  void allocBucketPage(PageId & pageNum, Page *& page);
+
+  /**
+   * Puts a pinned bucket page at the front of the chain of free pages, and unpins it.
+   */
+  void freeBucketPage(PageId pageNum, Page *page);
+
+  /**
+   * Writes the directory to its pages, allocating a new run of pages if it outgrew them, along with the meta page.
+   */
+  void writeDirectory();
+};
+
+}
@@ -0,0 +1,175 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "index_snapshot.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb
+{
+
+// -----------------------------------------------------------------------------
+// IndexSnapshot::IndexSnapshot -- Constructor
+// -----------------------------------------------------------------------------
+
+IndexSnapshot::IndexSnapshot(const std::string & snapshotName)
+{
+	IndexSnapshot::snapshotName = snapshotName;
+	scanExecuting = false;
+	nextEntry = 0;
+	highValInt = 0;
+	highOp = LTE;
+
+	fd = open(snapshotName.c_str(), O_RDONLY);
+	struct stat snapshotStat;
+	if(fd < 0 || fstat(fd, &snapshotStat) != 0 || snapshotStat.st_size < static_cast<off_t>(Page::SIZE)) {
+		if(fd >= 0) close(fd);
+		throw FileNotFoundException(snapshotName);
+	}
+
+	// a shared read-only mapping lets every process opening the snapshot use the same cached pages
+	size = static_cast<std::size_t>(snapshotStat.st_size);
+	void *mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if(mapping == MAP_FAILED) {
+		close(fd);
+		throw FileNotFoundException(snapshotName);
+	}
+	data = static_cast<const char*>(mapping);
+	header = reinterpret_cast<const SnapshotHeader*>(data);
+	leafKeys = reinterpret_cast<const int*>(data + Page::SIZE * (1 + static_cast<std::size_t>(header->leafCount)));
+
+	std::string reason;
+	if(memcmp(header->magic, SNAPSHOTMAGIC, sizeof(SNAPSHOTMAGIC)) != 0)
+		reason = "not an index snapshot";
+	else if(header->leafCount < 0 || header->entryCount < 0 ||
+			header->entryCount > static_cast<std::int64_t>(header->leafCount) * SNAPSHOTLEAFSIZE ||
+			size < Page::SIZE * (1 + static_cast<std::size_t>(header->leafCount)) + header->leafCount * sizeof(int))
+		reason = "snapshot is truncated";
+
+	if(!reason.empty()) {
+		munmap(mapping, size);
+		close(fd);
+		throw BadIndexInfoException(reason);
+	}
+
+	// the first keys of the leaves are read by every search; they start on a page boundary
+	if(header->leafCount > 0) {
+		madvise(const_cast<int*>(leafKeys), header->leafCount * sizeof(int), MADV_WILLNEED);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// IndexSnapshot::~IndexSnapshot -- destructor
+// -----------------------------------------------------------------------------
+
+IndexSnapshot::~IndexSnapshot()
+{
+	munmap(const_cast<char*>(data), size);
+	close(fd);
+}
+
+// -----------------------------------------------------------------------------
+// IndexSnapshot::findPosition
+// -----------------------------------------------------------------------------
+
+int IndexSnapshot::findPosition(int key, bool inclusive) const
+{
+	if(header->leafCount == 0) return 0;
+
+	// the leaf before the first one whose first key qualifies is the last that may hold a qualifying entry
+	int low = 0;
+	int high = header->leafCount;
+	while(low < high) {
+		int middle = low + (high - low) / 2;
+		if(inclusive ? leafKeys[middle] >= key : leafKeys[middle] > key)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	int leaf = low > 0 ? low - 1 : 0;
+
+	const SnapshotLeafInt &node = leafAt(leaf);
+	int count = std::min(SNAPSHOTLEAFSIZE, header->entryCount - leaf * SNAPSHOTLEAFSIZE);
+	const int *slot = inclusive ? std::lower_bound(node.keyArray, node.keyArray + count, key)
+		: std::upper_bound(node.keyArray, node.keyArray + count, key);
+
+	// past the end of the leaf, the first entry of the next one qualifies
+	return leaf * SNAPSHOTLEAFSIZE + static_cast<int>(slot - node.keyArray);
+}
+
+// -----------------------------------------------------------------------------
+// IndexSnapshot::startScan
+// -----------------------------------------------------------------------------
+
+void IndexSnapshot::startScan(const void* lowValParm,
+				   const Operator lowOpParm,
+				   const void* highValParm,
+				   const Operator highOpParm)
+{
+	if(lowOpParm != Operator::GT && lowOpParm != Operator::GTE) throw BadOpcodesException();
+	if(highOpParm != Operator::LT && highOpParm != Operator::LTE) throw BadOpcodesException();
+
+	int lowValInt = *reinterpret_cast<const int*>(lowValParm);
+	highValInt = *reinterpret_cast<const int*>(highValParm);
+	highOp = highOpParm;
+	if(lowValInt > highValInt) throw BadScanrangeException();
+
+	scanExecuting = false;
+	nextEntry = findPosition(lowValInt, lowOpParm == Operator::GTE);
+	if(nextEntry >= header->entryCount) throw NoSuchKeyFoundException();
+
+	int key = leafAt(nextEntry / SNAPSHOTLEAFSIZE).keyArray[nextEntry % SNAPSHOTLEAFSIZE];
+	if(highOp == Operator::LT ? key >= highValInt : key > highValInt) throw NoSuchKeyFoundException();
+
+	scanExecuting = true;
+}
+
+// -----------------------------------------------------------------------------
+// IndexSnapshot::scanNext
+// -----------------------------------------------------------------------------
+
+void IndexSnapshot::scanNext(RecordId& outRid)
+{
+	if(!scanExecuting) throw ScanNotInitializedException();
+	if(nextEntry >= header->entryCount) throw IndexScanCompletedException();
+
+	// leaves are contiguous, so the next entry is always at the next position
+	const SnapshotLeafInt &leaf = leafAt(nextEntry / SNAPSHOTLEAFSIZE);
+	int slot = nextEntry % SNAPSHOTLEAFSIZE;
+	int key = leaf.keyArray[slot];
+	if(highOp == Operator::LT ? key >= highValInt : key > highValInt) {
+		nextEntry = header->entryCount;
+		throw IndexScanCompletedException();
+	}
+
+	outRid = leaf.ridArray[slot];
+	nextEntry++;
+}
+
+// -----------------------------------------------------------------------------
+// IndexSnapshot::endScan
+// -----------------------------------------------------------------------------
+
+void IndexSnapshot::endScan()
+{
+	if(!scanExecuting) throw ScanNotInitializedException();
+
+	// nothing is pinned, the mapping stays until the snapshot is closed
+	scanExecuting = false;
+}
+
+}
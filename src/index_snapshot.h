@@ -0,0 +1,233 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+
+#include "types.h"
+#include "page.h"
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of entries in a leaf of an index snapshot. Every leaf but the last is full.
+ */
+const int SNAPSHOTLEAFSIZE = Page::SIZE / ( sizeof( int ) + sizeof( RecordId ) );
+
+/**
+ * @brief Identifies an index snapshot file and the version of its layout.
+ */
+const char SNAPSHOTMAGIC[8] = { 'B', 'D', 'B', 'S', 'N', 'A', 'P', '1' };
+
+/**
+ * @brief The header of an index snapshot, which fills the first page of the file.
+ * The leaves follow it back to back in key order, one per page, and the first key of every leaf comes after them.
+*/
+struct SnapshotHeader{
+  /**
+   * Always SNAPSHOTMAGIC.
+   */
+	char magic[8];
+
+  /**
+   * Name of base relation.
+   */
+	char relationName[20];
+
+  /**
+   * Offset of attribute, over which index is built, inside the record stored in pages.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute over which index is built.
+   */
+	Datatype attrType;
+
+  /**
+   * Number of entries in the snapshot.
+   */
+	int entryCount;
+
+  /**
+   * Number of leaves in the snapshot.
+   */
+	int leafCount;
+};
+
+/**
+ * @brief Structure for the leaves of an index snapshot on an integer attribute.
+*/
+struct SnapshotLeafInt{
+  /**
+   * Stores keys.
+   */
+	int keyArray[ SNAPSHOTLEAFSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ SNAPSHOTLEAFSIZE ];
+};
+
+static_assert(sizeof(SnapshotHeader) <= Page::SIZE && sizeof(SnapshotLeafInt) <= Page::SIZE,
+              "The header and the leaves of a snapshot must each fit in one page.");
+
+/**
+ * @brief IndexSnapshot class. It opens a read-only snapshot written by BTreeIndex::exportSnapshot() by mapping
+ * the file into memory, without a buffer manager. Nodes are read in place from the mapping, so processes opening
+ * the same snapshot share its pages in the page cache, and opening it costs nothing but the mapping itself.
+ * The first keys of the leaves form the only inner level; it is small enough to stay resident.
+*/
+class IndexSnapshot {
+
+ private:
+
+  /**
+   * Name of the snapshot file.
+   */
+	std::string	snapshotName;
+
+  /**
+   * Descriptor of the snapshot file.
+   */
+	int			fd;
+
+  /**
+   * Start of the mapping of the snapshot file.
+   */
+	const char	*data;
+
+  /**
+   * Length of the mapping.
+   */
+	std::size_t	size;
+
+  /**
+   * Header of the snapshot, in the mapping.
+   */
+	const SnapshotHeader	*header;
+
+  /**
+   * First key of every leaf, in the mapping.
+   */
+	const int	*leafKeys;
+
+  /**
+   * True if a scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Position, counting entries from the start of the first leaf, of the next entry to be scanned.
+   */
+	int			nextEntry;
+
+  /**
+   * High INTEGER value for scan.
+   */
+	int			highValInt;
+
+  /**
+   * High Operator. Can only be LT(<) or LTE(<=).
+   */
+	Operator	highOp;
+
+ public:
+
+  /**
+   * IndexSnapshot Constructor. Maps the snapshot file read-only and validates its header.
+   *
+   * @param snapshotName        Name of the snapshot file.
+   * @throws  FileNotFoundException     If the file doesn't exist or can't be mapped.
+   * @throws  BadIndexInfoException     If the file is not a snapshot or is truncated.
+   */
+	IndexSnapshot(const std::string & snapshotName);
+
+
+  /**
+   * IndexSnapshot Destructor. Unmaps and closes the snapshot file.
+	 * */
+	~IndexSnapshot();
+
+
+  /**
+	 * Begin a filtered scan of the snapshot, with the same parameters as BTreeIndex::startScan().
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+	 * @throws  NoSuchKeyFoundException If there is no key in the snapshot that satisfies the scan criteria.
+	**/
+	void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+  /**
+	 * Fetch the record id of the next entry that matches the scan.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	void scanNext(RecordId& outRid);
+
+
+  /**
+	 * Terminate the current scan.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	void endScan();
+
+
+  /**
+	 * Returns the name of the relation the snapshot was exported from.
+	**/
+	std::string getRelationName() const
+	{
+		return std::string(header->relationName, strnlen(header->relationName, sizeof(header->relationName)));
+	}
+
+  /**
+	 * Returns the offset of the indexed attribute inside records.
+	**/
+	int getAttrByteOffset() const
+	{
+		return header->attrByteOffset;
+	}
+
+  /**
+	 * Returns the number of entries in the snapshot.
+	**/
+	int getEntryCount() const
+	{
+		return header->entryCount;
+	}
+
+ private:
+
+  /**
+   * Returns the position of the first entry whose key is greater than or equal to (inclusive) or
+   * strictly greater than (not inclusive) the key, or entryCount if there is none.
+   */
+  int findPosition(int key, bool inclusive) const;
+
+  /**
+   * Returns a leaf of the snapshot, in the mapping. Leaves are a page apart.
+   */
+  const SnapshotLeafInt &leafAt(int leaf) const
+  {
+    return *reinterpret_cast<const SnapshotLeafInt*>(data + Page::SIZE * (1 + static_cast<std::size_t>(leaf)));
+  }
+};
+
+}
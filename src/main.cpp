@@ -6,9 +6,19 @@
  */
 
 #include <vector>
+#include <fstream>
+#include <climits>
 #include "btree.h"
 #include "page.h"
 #include "filescan.h"
+#include "relation.h"
+#include "hash_index.h"
+#include "index_snapshot.h"
+#include "composite_index.h"
+#include "bitmap_scan.h"
+#include "rid_bitmap.h"
+#include "async_index.h"
+#include "range_filter.h"
 #include "page_iterator.h"
 #include "file_iterator.h"
 #include "exceptions/insufficient_space_exception.h"
@@ -17,8 +27,11 @@
 #include "exceptions/no_such_key_found_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scan_param_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/file_write_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -67,12 +80,39 @@ void createRelationForward();
 void createRelationBackward();
 void createRelationRandom();
 void intTests();
-int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+void intReopenTests();
+void intMaintenanceTests();
+void intOnlineBuildTests();
+void intBloomTests();
+void intHashTests();
+void intBufferedTests();
+void intSnapshotTests();
+void intReorganizeTests();
+void compositeTests();
+void intBitmapScanTests();
+void intParallelScanTests();
+void intAsyncTests();
+void intFilterTests();
+void intCursorTests();
+void intPartialTests();
+void intRidBitmapTests();
+void intMultiBuildTests();
+void intLimitTests();
+int hashLookup(HashIndex *index, int key);
+int snapshotScan(IndexSnapshot *snapshot, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int bitmapScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, std::size_t chunkSize);
+int compositeScan(CompositeIndex *index, const CompositeKey& lowKey, Operator lowOp, const CompositeKey& highKey, Operator highOp);
+std::string makeRecord(int key);
+int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, const IndexPredicate *queryPredicate = NULL);
+int intMultiScan(BTreeIndex *index, const std::vector<ScanRange>& ranges, const ScanRange* keyFilter = NULL);
+int relationCount(int lowVal, int highVal);
+std::streamoff indexFileSize(const std::string & fileName);
 void indexTests();
 void test1();
 void test2();
 void test3();
 void errorTests();
+void extentTests();
 void deleteRelation();
 
 int main(int argc, char **argv)
@@ -138,6 +178,7 @@ int main(int argc, char **argv)
 	test2();
 	test3();
 	errorTests();
+	extentTests();
 
 	delete bufMgr;
 
@@ -346,6 +387,24 @@ void createRelationRandom()
 void indexTests()
 {
   intTests();
+  intReopenTests();
+  intMaintenanceTests();
+  intOnlineBuildTests();
+  intBloomTests();
+  intHashTests();
+  intBufferedTests();
+  intSnapshotTests();
+  intReorganizeTests();
+  compositeTests();
+  intBitmapScanTests();
+  intParallelScanTests();
+  intAsyncTests();
+  intFilterTests();
+  intCursorTests();
+  intPartialTests();
+  intRidBitmapTests();
+  intMultiBuildTests();
+  intLimitTests();
 	try
 	{
 		File::remove(intIndexName);
@@ -372,9 +431,1306 @@ void intTests()
 	checkPassFail(intScan(&index,0,GT,1,LT), 0)
 	checkPassFail(intScan(&index,300,GT,400,LT), 99)
 	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+	// keys are dense, so interpolation inside nodes should keep landing on target
+	checkPassFail(index.getSearchStrategy(), INTERPOLATION_SEARCH)
+
+	// the last key of the first leaf, and the first key of the second, from the leaf a scan is in
+	int lowKey = INT_MIN, highKey = INT_MAX;
+	ScanCursor cursor;
+	RecordId rid;
+	index.startScan(&lowKey, GTE, &highKey, LTE);
+	index.saveScan(cursor);
+	PageId firstLeaf = cursor.pageNo;
+	int lastKey = 0;
+	while(true)
+	{
+		index.scanNext(rid);
+		index.saveScan(cursor);
+		if(cursor.pageNo != firstLeaf) break;
+		lastKey = cursor.lastKey;
+	}
+	int nextKey = cursor.lastKey;
+	index.endScan();
+
+	// ranges ending at the edge of a leaf stop there or go on into the next leaf depending on the high operator
+	checkPassFail(intScan(&index,INT_MIN,GTE,lastKey,LTE) - intScan(&index,INT_MIN,GTE,lastKey,LT), 1)
+	checkPassFail(intScan(&index,INT_MIN,GTE,lastKey,LTE), intScan(&index,INT_MIN,GTE,nextKey,LT))
+	checkPassFail(intScan(&index,lastKey - 5,GT,nextKey,LTE), intScan(&index,lastKey - 5,GT,lastKey,LTE) + 1)
+	checkPassFail(intScan(&index,lastKey,GTE,lastKey,LTE), 1)
+	checkPassFail(intScan(&index,lastKey,GT,nextKey,LT), 0)
+	checkPassFail(intScan(&index,lastKey,GT,nextKey,LTE), 1)
+
+	// several ranges, and an IN list, in one scan
+	int low1 = 25, high1 = 40, low2 = 300, high2 = 400, low3 = 3000, high3 = 4000;
+	std::vector<ScanRange> ranges;
+	ScanRange range1 = { &low1, GT, &high1, LT };
+	ScanRange range2 = { &low2, GT, &high2, LT };
+	ScanRange range3 = { &low3, GTE, &high3, LT };
+	ranges.push_back(range1);
+	ranges.push_back(range2);
+	ranges.push_back(range3);
+	checkPassFail(intMultiScan(&index, ranges), 1113)
+
+	int inList[] = { -7, 3, 4, 690, 691, 4999, 5000 };
+	std::vector<ScanRange> inRanges;
+	for(int i = 0; i < 7; i++)
+	{
+		ScanRange inRange = { &inList[i], GTE, &inList[i], LTE };
+		inRanges.push_back(inRange);
+	}
+	checkPassFail(intMultiScan(&index, inRanges), 5)
+
+	// keys are dense and unique, so the histogram estimates should be exact
+	int low = 300, high = 400;
+	checkPassFail(index.getIndexStats().distinctKeys, relationSize)
+	checkPassFail((int)(index.estimateRange(&low, GT, &high, LT) + 0.5), 99)
+	checkPassFail((int)(index.estimateRange(&low, GTE, &low, LTE) + 0.5), 1)
+
+	// a learned model over the leaves replaces descents until the index is modified
+	index.trainModel();
+	index.clearSearchStats();
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+	checkPassFail(intMultiScan(&index, inRanges), 5)
+	checkPassFail((index.getSearchStats().modelSeeks > 0), true)
+	checkPassFail(index.getSearchStats().modelFallbacks, 0)
+
+	int extraKey = relationSize + 50;
+	RecordId extraRid;
+	extraRid.page_number = 1;
+	extraRid.slot_number = 1;
+	index.insertEntry(&extraKey, extraRid);
+	checkPassFail(index.hasValidModel(), false)
+	checkPassFail(index.getIndexStats().distinctKeys, relationSize + 1)
+	checkPassFail((int)(index.estimateRange(&extraKey, GTE, &extraKey, LTE) + 0.5), 1)
+	index.deleteEntry(&extraKey, extraRid);
+	checkPassFail(intScan(&index,300,GT,400,LT), 99)
+
+	// an index without entries gets no model, before and after it is reopened
+	std::string emptyName;
+	IndexPredicate none = { offsetof(tuple,d), DOUBLE, LT, -1 };
+	{
+		BTreeIndex emptyIndex(relationName, emptyName, bufMgr, offsetof(tuple,i), INTEGER, false, false, false, &none);
+		emptyIndex.trainModel();
+		checkPassFail(emptyIndex.hasValidModel(), false)
+	}
+	{
+		BTreeIndex emptyIndex(relationName, emptyName, bufMgr, offsetof(tuple,i), INTEGER, false, false, false, &none);
+		checkPassFail(emptyIndex.hasValidModel(), false)
+	}
+	File::remove(emptyName);
+}
+
+// -----------------------------------------------------------------------------
+// intReopenTests
+// -----------------------------------------------------------------------------
+
+void intReopenTests()
+{
+  std::cout << "Reopen the B+ Tree index on the integer field" << std::endl;
+	int allRecords = relationCount(INT_MIN, INT_MAX);
+	int lastRecords = relationCount(relationSize - 1, relationSize);
+	{
+		// the relation is unchanged, so the index is opened without being rebuilt
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScan(&index,25,GT,40,LT), relationCount(26, 39))
+		checkPassFail(intScan(&index,3000,GTE,4000,LT), relationCount(3000, 3999))
+		checkPassFail(index.getIndexStats().numEntries, allRecords)
+	}
+
+	try
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), DOUBLE);
+		std::cout << "BadIndexInfoException Test 1 Failed." << std::endl;
+	}
+	catch(const BadIndexInfoException &e)
+	{
+		std::cout << "BadIndexInfoException Test 1 Passed." << std::endl;
+	}
+
+	{
+		// a relation changed since the index was built gets its index rebuilt
+		PageId new_page_number;
+		Page new_page = file1->allocatePage(new_page_number);
+		sprintf(record1.s, "%05d string record", relationSize);
+		record1.i = relationSize;
+		record1.d = (double)relationSize;
+		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+		new_page.insertRecord(new_data);
+		file1->writePage(new_page_number, new_page);
+
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScan(&index,relationSize - 1,GTE,relationSize,LTE), lastRecords + 1)
+		checkPassFail(index.getIndexStats().numEntries, allRecords + 1)
+	}
+}
+
+// -----------------------------------------------------------------------------
+// intMaintenanceTests
+// -----------------------------------------------------------------------------
+
+void intMaintenanceTests()
+{
+  std::cout << "Maintain the B+ Tree index on the integer field through relation writes" << std::endl;
+	int allRecords = relationCount(INT_MIN, INT_MAX);
+	int updatedRecords = relationCount(relationSize + 10, relationSize + 19);
+	int deferredRecords = relationCount(relationSize + 100, relationSize + 119);
+	int negativeRecords = relationCount(-19, -1);
+	{
+		// the relation is declared last so that it applies its pending updates before the index goes away
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		Relation relation(file1, bufMgr);
+		relation.registerIndex(&index);
+
+		// inserts, deletes and key changing updates show up in the index right away
+		std::vector<RecordId> rids;
+		for(int i = 0; i < 10; i++)
+		{
+			rids.push_back(relation.insertRecord(makeRecord(relationSize + 10 + i)));
+		}
+		checkPassFail(intScan(&index,relationSize + 10,GTE,relationSize + 20,LT), updatedRecords + 10)
+
+		for(int i = 0; i < 5; i++)
+		{
+			relation.deleteRecord(rids[i]);
+		}
+		relation.updateRecord(rids[5], makeRecord(-10));
+		checkPassFail(intScan(&index,relationSize + 10,GTE,relationSize + 20,LT), updatedRecords + 4)
+		checkPassFail(intScan(&index,-20,GT,0,LT), negativeRecords + 1)
+
+		// deferred updates wait for flushIndexUpdates
+		std::vector<std::string> records;
+		for(int i = 0; i < 20; i++)
+		{
+			records.push_back(makeRecord(relationSize + 100 + i));
+		}
+		relation.setDeferred(true);
+		relation.insertRecords(records);
+		checkPassFail(intScan(&index,relationSize + 100,GTE,relationSize + 120,LT), deferredRecords)
+		relation.flushIndexUpdates();
+		checkPassFail(intScan(&index,relationSize + 100,GTE,relationSize + 120,LT), deferredRecords + 20)
+
+		relation.flush();
+	}
+
+	{
+		// the flushed relation and index are in sync, so the index is opened without being rebuilt
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScan(&index,-20,GT,0,LT), negativeRecords + 1)
+		checkPassFail(intScan(&index,relationSize + 10,GTE,relationSize + 120,LT), relationCount(relationSize + 10, relationSize + 119))
+		checkPassFail(index.getIndexStats().numEntries, allRecords + 25)
+	}
+}
+
+// -----------------------------------------------------------------------------
+// intOnlineBuildTests
+// -----------------------------------------------------------------------------
+
+void intOnlineBuildTests()
+{
+  std::cout << "Build the B+ Tree index on the integer field online" << std::endl;
+	File::remove(intIndexName);
+
+	// the first record of the relation is read early by the build
+	RecordId firstRid;
+	int firstKey;
+	{
+		FileScan scan(relationName, bufMgr);
+		scan.scanNext(firstRid);
+		firstKey = reinterpret_cast<const RECORD*>(scan.getRecord().data())->i;
+	}
+	int allRecords = relationCount(INT_MIN, INT_MAX);
+	int insertedRecords = relationCount(relationSize + 200, relationSize + 209);
+	int updatedRecords = relationCount(-30, -30);
+	int firstRecords = relationCount(firstKey, firstKey);
+	int liveRecords = relationCount(relationSize + 300, relationSize + 300);
+
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, true);
+	Relation relation(file1, bufMgr);
+	relation.startIndexBuild(&index);
+	checkPassFail(relation.buildIndexStep(&index, 100), false)
+	checkPassFail(index.isBuilding(), true)
+
+	// writes behind the build and ahead of it go to the side log
+	std::vector<RecordId> rids;
+	for(int i = 0; i < 10; i++)
+	{
+		rids.push_back(relation.insertRecord(makeRecord(relationSize + 200 + i)));
+	}
+	for(int i = 0; i < 5; i++)
+	{
+		relation.deleteRecord(rids[i]);
+	}
+	relation.updateRecord(rids[5], makeRecord(-30));
+	relation.deleteRecord(firstRid);
+
+	while(!relation.buildIndexStep(&index, 1000))
+	{
+	}
+	checkPassFail(index.isBuilding(), false)
+	checkPassFail(intScan(&index,relationSize + 200,GTE,relationSize + 210,LT), insertedRecords + 4)
+	checkPassFail(intScan(&index,-30,GTE,-30,LTE), updatedRecords + 1)
+	checkPassFail(intScan(&index,firstKey,GTE,firstKey,LTE), firstRecords - 1)
+	checkPassFail(index.getIndexStats().numEntries, allRecords + 5 - 1)
+
+	// once live the index is maintained directly
+	relation.insertRecord(makeRecord(relationSize + 300));
+	checkPassFail(intScan(&index,relationSize + 300,GTE,relationSize + 300,LTE), liveRecords + 1)
+	relation.flush();
+}
+
+// -----------------------------------------------------------------------------
+// intBloomTests
+// -----------------------------------------------------------------------------
+
+void intBloomTests()
+{
+  std::cout << "Filter point lookups on the integer field with a Bloom filter" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, false, true);
+	Relation relation(file1, bufMgr);
+	relation.registerIndex(&index);
+	checkPassFail(index.hasBloomFilter(), true)
+
+	// absent keys are answered by the filter, present ones still found
+	std::vector<int> keys;
+	std::vector<ScanRange> ranges;
+	int absentKey = relationSize + 1000;
+	int presentRecords = relationCount(relationSize / 2, relationSize / 2);
+	int absentRecords = relationCount(absentKey, absentKey + 999);
+	keys.push_back(relationSize / 2);
+	for(int i = 0; i < 1000; i++)
+	{
+		keys.push_back(absentKey + i);
+	}
+	for(std::size_t i = 0; i < keys.size(); i++)
+	{
+		ScanRange range = { &keys[i], GTE, &keys[i], LTE };
+		ranges.push_back(range);
+	}
+	checkPassFail(intMultiScan(&index, ranges), presentRecords + absentRecords)
+	checkPassFail((static_cast<int>(index.getBloomStats().negatives) >= 950 - absentRecords), true)
+
+	// deleted keys stay in the filter until the false positives they cause get it rebuilt
+	checkPassFail(relationCount(relationSize + 5000, relationSize + 6999), 0)
+	std::vector<std::string> records;
+	for(int i = 0; i < 2000; i++)
+	{
+		records.push_back(makeRecord(relationSize + 5000 + i));
+	}
+	std::vector<RecordId> rids = relation.insertRecords(records);
+	for(std::size_t i = 0; i < rids.size(); i++)
+	{
+		relation.deleteRecord(rids[i]);
+	}
+
+	keys.clear();
+	ranges.clear();
+	for(int i = 0; i < 2000; i++)
+	{
+		keys.push_back(relationSize + 5000 + i);
+	}
+	for(std::size_t i = 0; i < keys.size(); i++)
+	{
+		ScanRange range = { &keys[i], GTE, &keys[i], LTE };
+		ranges.push_back(range);
+	}
+	checkPassFail(intMultiScan(&index, ranges), 0)
+	checkPassFail(index.getBloomStats().rebuilds, 1)
+
+	std::uint64_t negatives = index.getBloomStats().negatives;
+	checkPassFail(intMultiScan(&index, ranges), 0)
+	checkPassFail((index.getBloomStats().negatives - negatives >= 1900), true)
+	relation.flush();
+}
+
+// -----------------------------------------------------------------------------
+// intHashTests
+// -----------------------------------------------------------------------------
+
+void intHashTests()
+{
+  std::cout << "Create a hash index on the integer field" << std::endl;
+	std::string hashIndexName;
+	int dupKey = -100, middleKey = relationSize / 2;
+	int allRecords = relationCount(INT_MIN, INT_MAX);
+	int dupRecords = relationCount(dupKey, dupKey);
+	int middleRecords = relationCount(middleKey, middleKey);
+	{
+		HashIndex index(relationName, hashIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.getNumEntries(), allRecords)
+		checkPassFail(hashLookup(&index, middleKey), middleRecords)
+		checkPassFail(hashLookup(&index, relationSize - 1), relationCount(relationSize - 1, relationSize - 1))
+		checkPassFail(hashLookup(&index, relationSize + 1000), relationCount(relationSize + 1000, relationSize + 1000))
+
+		// more entries of one key than a bucket holds go to overflow pages
+		RecordId rid;
+		for(int i = 0; i < 1000; i++)
+		{
+			rid.page_number = 1;
+			rid.slot_number = i + 1;
+			index.insertEntry(&dupKey, rid);
+		}
+		checkPassFail(hashLookup(&index, dupKey), dupRecords + 1000)
+		index.deleteEntry(&dupKey, rid);
+		checkPassFail(hashLookup(&index, dupKey), dupRecords + 999)
+
+		// a key landing in the bucket of the key splits it; its overflow pages are freed, and taken again by its entries
+		int depth = index.getGlobalDepth();
+		std::uint32_t mask = (std::uint32_t(1) << depth) - 1;
+		int splitKey = -1000;
+		while(((hashKey(splitKey) ^ hashKey(dupKey)) & mask) != 0 || ((hashKey(splitKey) >> depth) & 1) == ((hashKey(dupKey) >> depth) & 1))
+		{
+			splitKey--;
+		}
+		rid.page_number = 1;
+		rid.slot_number = 1;
+		index.insertEntry(&splitKey, rid);
+		checkPassFail(index.getGlobalDepth(), depth + 1)
+		checkPassFail(index.getFreePageCount(), 0)
+		index.deleteEntry(&splitKey, rid);
+		checkPassFail(hashLookup(&index, dupKey), dupRecords + 999)
+	}
+
+	{
+		// the relation is unchanged, so the index is opened with its directory
+		HashIndex index(relationName, hashIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(hashLookup(&index, dupKey), dupRecords + 999)
+		checkPassFail(hashLookup(&index, middleKey), middleRecords)
+		checkPassFail(index.getNumEntries(), allRecords + 999)
+	}
+
+	File::remove(hashIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// intBufferedTests
+// -----------------------------------------------------------------------------
+
+void intBufferedTests()
+{
+  std::cout << "Buffer inserts and deletes in the non-leaf nodes of the B+ Tree index" << std::endl;
+	File::remove(intIndexName);
+	int bufferedRecords = relationCount(relationSize + 2000, relationSize + 2599);
+	int bufferOnlyRecords = relationCount(relationSize + 2605, relationSize + 2605);
+	int tailRecords = relationCount(relationSize + 2000, relationSize + 2609);
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, false, false, true);
+		Relation relation(file1, bufMgr);
+		relation.registerIndex(&index);
+		checkPassFail(index.hasBufferedNodes(), true)
+
+		// random keys overflow the root buffer, so some go down while others are still buffered
+		std::vector<std::string> records;
+		for(int i = 0; i < 600; i++)
+		{
+			records.push_back(makeRecord(relationSize + 2000 + (i * 37) % 600));
+		}
+		std::vector<RecordId> rids = relation.insertRecords(records);
+		checkPassFail(intScan(&index,relationSize + 2000,GTE,relationSize + 2600,LT), bufferedRecords + 600)
+
+		for(int i = 0; i < 100; i++)
+		{
+			relation.deleteRecord(rids[i * 6]);
+		}
+		checkPassFail(intScan(&index,relationSize + 2000,GTE,relationSize + 2600,LT), bufferedRecords + 500)
+		checkPassFail((index.countPendingMessages() > 0), true)
+
+		// a residual filter selects among leaf entries and buffered inserts alike
+		int lowVal = relationSize + 2000, highVal = relationSize + 2600, filterLow = relationSize + 2100, filterHigh = relationSize + 2199;
+		ScanRange range = { &lowVal, GTE, &highVal, LT };
+		ScanRange filter = { &filterLow, GTE, &filterHigh, LTE };
+		checkPassFail(intMultiScan(&index, std::vector<ScanRange>(1, range), &filter), intScan(&index,filterLow,GTE,filterHigh,LTE))
+
+		index.flushMessages();
+		checkPassFail(index.countPendingMessages(), 0)
+		checkPassFail(intScan(&index,relationSize + 2000,GTE,relationSize + 2600,LT), bufferedRecords + 500)
+
+		// keys only held by buffers are found even where no leaf entry matches
+		records.clear();
+		for(int i = 0; i < 10; i++)
+		{
+			records.push_back(makeRecord(relationSize + 2600 + i));
+		}
+		relation.insertRecords(records);
+		checkPassFail(intScan(&index,relationSize + 2605,GTE,relationSize + 2605,LTE), bufferOnlyRecords + 1)
+		relation.flush();
+	}
+
+	{
+		// the mode and the buffered messages are kept in the index file
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.hasBufferedNodes(), true)
+		checkPassFail((index.countPendingMessages() > 0), true)
+		checkPassFail(intScan(&index,relationSize + 2000,GTE,relationSize + 2610,LT), tailRecords + 510)
+	}
+}
+
+// -----------------------------------------------------------------------------
+// intSnapshotTests
+// -----------------------------------------------------------------------------
+
+void intSnapshotTests()
+{
+  std::cout << "Export the B+ Tree index as a memory-mapped snapshot" << std::endl;
+	std::string snapshotName = intIndexName + ".snapshot";
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	index.exportSnapshot(snapshotName);
+
+	{
+		// the snapshot answers scans like the index it was exported from
+		IndexSnapshot snapshot(snapshotName);
+		checkPassFail(snapshot.getEntryCount(), index.getIndexStats().numEntries)
+		checkPassFail(snapshotScan(&snapshot,25,GT,40,LT), intScan(&index,25,GT,40,LT))
+		checkPassFail(snapshotScan(&snapshot,0,GTE,relationSize,LT), intScan(&index,0,GTE,relationSize,LT))
+		checkPassFail(snapshotScan(&snapshot,relationSize,GTE,INT_MAX,LT), intScan(&index,relationSize,GTE,INT_MAX,LT))
+		checkPassFail(snapshotScan(&snapshot,INT_MIN,GT,0,LT), intScan(&index,INT_MIN,GT,0,LT))
+	}
+	File::remove(snapshotName);
+
+	// a snapshot that can't be written throws instead of leaving a missing or truncated file behind
+	try
+	{
+		index.exportSnapshot("missing_directory/" + snapshotName);
+		std::cout << "exportSnapshot to a missing directory should throw" << std::endl;
+		exit(1);
+	}
+	catch(const FileWriteException &e)
+	{
+	}
+}
+
+// -----------------------------------------------------------------------------
+// intReorganizeTests
+// -----------------------------------------------------------------------------
+
+void intReorganizeTests()
+{
+  std::cout << "Lay out the leaves of the B+ Tree index sequentially" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	Relation relation(file1, bufMgr);
+	relation.registerIndex(&index);
+
+	int allEntries = intScan(&index,INT_MIN,GTE,INT_MAX,LTE);
+	int upperEntries = intScan(&index,relationSize,GTE,INT_MAX,LTE);
+	int insertedRecords = relationCount(relationSize + 2700, relationSize + 2700);
+
+	// splits in the middle of the key range put leaves at the end of the file, out of key order
+	int middleKey = relationSize / 2, lowVal = 0, highVal = relationSize;
+	std::vector<RecordId> middleRids;
+	index.parallelScan(&lowVal, GTE, &highVal, LT, 1, middleRids);
+	middleRids.resize(2 * INTARRAYLEAFSIZE);
+	for(std::size_t i = 0; i < middleRids.size(); i++)
+	{
+		index.insertEntry(&middleKey, middleRids[i]);
+	}
+	checkPassFail((index.leafFragmentation() > 0), true)
+
+	index.reorganize();
+	checkPassFail(index.leafFragmentation(), 0)
+	checkPassFail(intScan(&index,INT_MIN,GTE,INT_MAX,LTE), allEntries + 2 * INTARRAYLEAFSIZE)
+	checkPassFail(intScan(&index,relationSize,GTE,INT_MAX,LTE), upperEntries)
+	for(std::size_t i = 0; i < middleRids.size(); i++)
+	{
+		index.deleteEntry(&middleKey, middleRids[i]);
+	}
+
+	// the old nodes are reused, so reorganizing an index that didn't grow doesn't grow the file
+	std::streamoff fileSize = indexFileSize(intIndexName);
+	index.reorganize();
+	checkPassFail(indexFileSize(intIndexName), fileSize)
+	index.reorganize();
+	checkPassFail(indexFileSize(intIndexName), fileSize)
+	checkPassFail(intScan(&index,INT_MIN,GTE,INT_MAX,LTE), allEntries)
+
+	// the rebuilt levels take further inserts
+	relation.insertRecord(makeRecord(relationSize + 2700));
+	checkPassFail(intScan(&index,relationSize + 2700,GTE,relationSize + 2700,LTE), insertedRecords + 1)
+	relation.flush();
+}
+
+// -----------------------------------------------------------------------------
+// compositeTests
+// -----------------------------------------------------------------------------
+
+void compositeTests()
+{
+  std::cout << "Create composite indexes on (i, d) and (s, i)" << std::endl;
+	BTreeIndex intIndex(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	CompositeAttribute iAttr = { offsetof(tuple,i), INTEGER, 0 };
+	CompositeAttribute dAttr = { offsetof(tuple,d), DOUBLE, 0 };
+	CompositeAttribute sAttr = { offsetof(tuple,s), STRING, 10 };
+	std::vector<CompositeAttribute> idAttrs = { iAttr, dAttr };
+	std::vector<CompositeAttribute> siAttrs = { sAttr, iAttr };
+	std::string idIndexName, siIndexName;
+	int idEntries;
+
+	{
+		CompositeIndex index(relationName, idIndexName, bufMgr, idAttrs);
+		checkPassFail(index.getKeyLength(), 12)
+		checkPassFail(index.getNumEntries(), intIndex.getIndexStats().numEntries)
+
+		CompositeKey low, high;
+		int lowInt = 25, highInt = 40;
+		double lowDouble = 25, highDouble = 40;
+		index.encodeValues({ &lowInt, &lowDouble }, low);
+		index.encodeValues({ &highInt, &highDouble }, high);
+		checkPassFail(compositeScan(&index, low, GT, high, LT), intScan(&intIndex,25,GT,40,LT))
+
+		// a prefix of the attributes selects a range of keys
+		lowInt = 1000;
+		highInt = 1610;
+		index.encodeValues({ &lowInt }, low);
+		index.encodeValues({ &highInt }, high);
+		checkPassFail(compositeScan(&index, low, GTE, high, LT), intScan(&intIndex,1000,GTE,1610,LT))
+
+		// negative values of both types sort before positive ones, ahead of any record with the key (whose d is -5)
+		int key = -5;
+		int keyRecords = relationCount(key, key);
+		double values[] = { 2.5, -0.5, -2.5 };
+		RecordId rid = { 1, 1, 0 };
+		CompositeKey entry;
+		for(int i = 0; i < 3; i++)
+		{
+			rid.slot_number = i + 1;
+			index.encodeValues({ &key, &values[i] }, entry);
+			index.insertEntry(entry, rid);
+		}
+		index.encodeValues({ &key }, low);
+		index.encodeValues({ &key }, high, true);
+		checkPassFail(compositeScan(&index, low, GTE, high, LTE), keyRecords + 3)
+		index.encodeValues({ &key, &values[2] }, low);
+		index.startScan(low, GTE, high, LTE);
+		index.scanNext(rid);
+		index.endScan();
+		checkPassFail(rid.slot_number, 3)
+		idEntries = index.getNumEntries();
+	}
+
+	{
+		// the relation is unchanged, so the index is opened as it was left
+		CompositeIndex index(relationName, idIndexName, bufMgr, idAttrs);
+		checkPassFail(index.getNumEntries(), idEntries)
+	}
+
+	{
+		CompositeIndex index(relationName, siIndexName, bufMgr, siAttrs);
+		CompositeKey low, high;
+		index.encodeValues({ "00100 stri" }, low);
+		index.encodeValues({ "00199 stri" }, high, true);
+		checkPassFail(compositeScan(&index, low, GTE, high, LTE), relationCount(100, 199))
+	}
+
+	File::remove(idIndexName);
+	File::remove(siIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// intBitmapScanTests
+// -----------------------------------------------------------------------------
+
+void intBitmapScanTests()
+{
+  std::cout << "Fetch the records of index ranges in page order" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	checkPassFail(bitmapScan(&index,25,GT,40,LT,0), intScan(&index,25,GT,40,LT))
+	int allEntries = intScan(&index,0,GTE,relationSize,LT);
+	checkPassFail(bitmapScan(&index,0,GTE,relationSize,LT,0), allEntries)
+	checkPassFail(bitmapScan(&index,0,GTE,relationSize,LT,700), allEntries)
+	checkPassFail(bitmapScan(&index,1000,GTE,1610,LT,100), intScan(&index,1000,GTE,1610,LT))
+	checkPassFail(bitmapScan(&index,relationSize,GTE,INT_MAX,LT,0), intScan(&index,relationSize,GTE,INT_MAX,LT))
+}
+
+// -----------------------------------------------------------------------------
+// intParallelScanTests
+// -----------------------------------------------------------------------------
+
+void intParallelScanTests()
+{
+  std::cout << "Scan index ranges with several threads" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	int lowVal = 0, highVal = relationSize;
+
+	// the sub-ranges put together give the entries of a plain scan, in the same order
+	std::vector<RecordId> scanRids;
+	index.startScan(&lowVal, GTE, &highVal, LT);
+	try
+	{
+		RecordId scanRid;
+		while(1)
+		{
+			index.scanNext(scanRid);
+			scanRids.push_back(scanRid);
+		}
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+	index.endScan();
+
+	std::vector< std::vector<RecordId> > partRids;
+	index.parallelScan(&lowVal, GTE, &highVal, LT, 4, partRids);
+	checkPassFail(partRids.size(), 4u)
+	checkPassFail((partRids[0].size() > 0 && partRids[3].size() > 0), true)
+
+	std::vector<RecordId> mergedRids;
+	index.parallelScan(&lowVal, GTE, &highVal, LT, 4, mergedRids);
+	checkPassFail((mergedRids == scanRids), true)
+
+	lowVal = 1000;
+	highVal = 1610;
+	index.parallelScan(&lowVal, GTE, &highVal, LT, 3, mergedRids);
+	checkPassFail(static_cast<int>(mergedRids.size()), intScan(&index,1000,GTE,1610,LT))
+	index.parallelScan(&lowVal, GT, &lowVal, LTE, 3, partRids);
+	checkPassFail(partRids.size(), 0u)
+}
+
+// -----------------------------------------------------------------------------
+// intAsyncTests
+// -----------------------------------------------------------------------------
+
+void intAsyncTests()
+{
+  std::cout << "Interleave index lookups and scans as coroutines" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	AsyncIndexScheduler scheduler(&index, 8);
+
+	std::vector< std::vector<RecordId> > lookupRids(100);
+	for(int i = 0; i < 100; i++)
+	{
+		int key = 100 + i * 37;
+		scheduler.lookup(&key, lookupRids[i]);
+	}
+	int lowVal = 1000, highVal = 1610;
+	std::vector<RecordId> scanRids;
+	scheduler.scan(&lowVal, GTE, &highVal, LT, scanRids);
+	scheduler.run();
+
+	// the index was just opened, so most of its leaves weren't in the buffer pool
+	checkPassFail((scheduler.getSuspensions() > 0), true)
+	std::vector<RecordId> expectedRids;
+	index.parallelScan(&lowVal, GTE, &highVal, LT, 1, expectedRids);
+	checkPassFail((scanRids == expectedRids), true)
+
+	int found = 0;
+	for(int i = 0; i < 100; i++)
+	{
+		int key = 100 + i * 37;
+		index.parallelScan(&key, GTE, &key, LTE, 1, expectedRids);
+		if(lookupRids[i] == expectedRids) found++;
+	}
+	checkPassFail(found, 100)
+
+	// batched lookups find the same entries, group by group
+	std::vector<int> keys;
+	for(int i = 0; i < 100; i++)
+	{
+		keys.push_back(100 + i * 37);
+	}
+	keys.push_back(relationSize + 1500);
+	std::vector< std::vector<RecordId> > batchRids;
+	index.lookupBatch(keys, batchRids, 7);
+	lookupRids.push_back(std::vector<RecordId>());
+	index.parallelScan(&keys.back(), GTE, &keys.back(), LTE, 1, lookupRids.back());
+	checkPassFail((batchRids == lookupRids), true)
+}
+
+// -----------------------------------------------------------------------------
+// intFilterTests
+// -----------------------------------------------------------------------------
+
+void intFilterTests()
+{
+  std::cout << "Filter keys with the range filter kernels" << std::endl;
+
+	// the dispatched kernel, the scalar one and the bitmask agree
+	int keys[INTARRAYLEAFSIZE];
+	for(int i = 0; i < INTARRAYLEAFSIZE; i++)
+	{
+		keys[i] = (i * 7919) % 1000 - 500;
+	}
+	std::vector<int> selection(INTARRAYLEAFSIZE), scalarSelection(INTARRAYLEAFSIZE);
+	int selected = selectKeyRange(keys, INTARRAYLEAFSIZE, -100, GT, 250, LTE, &selection[0]);
+	int scalarSelected = selectKeyRangeScalar(keys, INTARRAYLEAFSIZE, -100, GT, 250, LTE, &scalarSelection[0]);
+	selection.resize(selected);
+	scalarSelection.resize(scalarSelected);
+	checkPassFail((selected > 0 && selection == scalarSelection), true)
+
+	std::uint64_t mask[(INTARRAYLEAFSIZE + 63) / 64];
+	maskKeyRange(keys, INTARRAYLEAFSIZE, -100, GT, 250, LTE, mask);
+	int maskSelected = 0;
+	for(int i = 0; i < INTARRAYLEAFSIZE; i++)
+	{
+		if(mask[i / 64] & (std::uint64_t(1) << (i % 64))) maskSelected++;
+	}
+	checkPassFail(maskSelected, selected)
+	checkPassFail(countKeysBetween(keys, INTARRAYLEAFSIZE, -99, 250), selected)
+
+	// a scan with a residual filter returns the entries that pass both
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	int lowVal = 0, highVal = relationSize, filterLow = 100, filterHigh = 199;
+	ScanRange range = { &lowVal, GTE, &highVal, LT };
+	ScanRange filter = { &filterLow, GTE, &filterHigh, LTE };
+	std::vector<ScanRange> ranges(1, range);
+	checkPassFail(intMultiScan(&index, ranges, &filter), intScan(&index, 100, GTE, 199, LTE))
+
+	int secondLow = relationSize + 2000, secondHigh = relationSize + 2610;
+	filterLow = relationSize + 2600;
+	filterHigh = INT_MAX;
+	ScanRange second = { &secondLow, GTE, &secondHigh, LT };
+	ranges.push_back(second);
+	filter.lowOp = GT;
+	checkPassFail(intMultiScan(&index, ranges, &filter), intScan(&index, relationSize + 2600, GT, relationSize + 2610, LT))
+
+	filterLow = relationSize + 1000;
+	filterHigh = relationSize + 1999;
+	checkPassFail(intMultiScan(&index, ranges, &filter), 0)
+}
+
+// -----------------------------------------------------------------------------
+// intCursorTests
+// -----------------------------------------------------------------------------
+
+void intCursorTests()
+{
+  std::cout << "Save and resume scans between pages of results" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	int lowVal = 0, highVal = relationSize;
+
+	std::vector<RecordId> scanRids;
+	index.parallelScan(&lowVal, GTE, &highVal, LT, 1, scanRids);
+
+	// pages of 100 entries, each one resumed from the cursor of the previous one
+	std::vector<RecordId> pagedRids;
+	ScanCursor cursor;
+	index.startScan(&lowVal, GTE, &highVal, LT);
+	bool completed = false;
+	while(!completed)
+	{
+		try
+		{
+			RecordId rid;
+			for(int i = 0; i < 100; i++)
+			{
+				index.scanNext(rid);
+				pagedRids.push_back(rid);
+			}
+			index.saveScan(cursor);
+			index.endScan();
+			index.resumeScan(cursor);
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			completed = true;
+		}
+	}
+	index.endScan();
+	checkPassFail((pagedRids == scanRids), true)
+
+	// a changed leaf sends the resumed scan through a descent, which still continues after the last entry
+	lowVal = 1000;
+	highVal = 1610;
+	index.parallelScan(&lowVal, GTE, &highVal, LT, 1, scanRids);
+	index.startScan(&lowVal, GTE, &highVal, LT);
+	RecordId rid;
+	for(int i = 0; i < 10; i++)
+	{
+		index.scanNext(rid);
+	}
+	index.saveScan(cursor);
+	index.endScan();
+
+	int extraKey = 1500;
+	RecordId extraRid;
+	extraRid.page_number = 1;
+	extraRid.slot_number = 1;
+	index.insertEntry(&extraKey, extraRid);
+	index.resumeScan(cursor);
+	int remaining = 0;
+	try
+	{
+		while(1)
+		{
+			index.scanNext(rid);
+			remaining++;
+		}
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+	index.endScan();
+	index.deleteEntry(&extraKey, extraRid);
+	checkPassFail(remaining, static_cast<int>(scanRids.size()) - 10 + 1)
+
+	// a saved multi-range scan isn't supported
+	std::vector<ScanRange> ranges;
+	int firstHigh = lowVal + 100, secondLow = highVal - 100;
+	ScanRange first = { &lowVal, GTE, &firstHigh, LT };
+	ScanRange second = { &secondLow, GTE, &highVal, LT };
+	ranges.push_back(first);
+	ranges.push_back(second);
+	index.startScan(ranges);
+	try
+	{
+		index.saveScan(cursor);
+		std::cout << "saveScan of a multi-range scan should throw" << std::endl;
+		exit(1);
+	}
+	catch(const BadScanParamException &e)
+	{
+	}
+	index.endScan();
+
+	// a cursor is checked like the parameters of startScan()
+	ScanCursor bad = cursor;
+	bad.lowOp = LT;
+	try
+	{
+		index.resumeScan(bad);
+		std::cout << "resumeScan with a bad operator should throw" << std::endl;
+		exit(1);
+	}
+	catch(const BadOpcodesException &e)
+	{
+	}
+	bad = cursor;
+	bad.lowVal = bad.highVal + 1;
+	try
+	{
+		index.resumeScan(bad);
+		std::cout << "resumeScan with a bad range should throw" << std::endl;
+		exit(1);
+	}
+	catch(const BadScanrangeException &e)
+	{
+	}
+
+	// a page past the end of the file can't be read, so the scan resumes with a descent
+	bad = cursor;
+	bad.pageNo = 1 << 30;
+	index.resumeScan(bad);
+	remaining = 0;
+	try
+	{
+		while(1)
+		{
+			index.scanNext(rid);
+			remaining++;
+		}
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+	index.endScan();
+	checkPassFail(remaining, static_cast<int>(scanRids.size()) - 10)
+}
+
+// -----------------------------------------------------------------------------
+// intPartialTests
+// -----------------------------------------------------------------------------
+
+void intPartialTests()
+{
+  std::cout << "Index only the records satisfying a predicate" << std::endl;
+	std::string partialName, keyPartialName;
+	{
+		BTreeIndex fullIndex(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int hotEntries = intScan(&fullIndex, 4000, GTE, INT_MAX, LT);
+
+		IndexPredicate hot = { offsetof(tuple,d), DOUBLE, GTE, 4000 };
+		BTreeIndex index(relationName, partialName, bufMgr, offsetof(tuple,i), INTEGER, false, false, false, &hot);
+		checkPassFail(intScan(&index, INT_MIN, GT, INT_MAX, LT, &hot), hotEntries)
+
+		// a scan without a query predicate implying the index predicate is rejected, not answered with a subset
+		int minKey = INT_MIN, maxKey = INT_MAX;
+		try
+		{
+			index.startScan(&minKey, GT, &maxKey, LT);
+			std::cout << "startScan of an uncovered range should throw" << std::endl;
+			exit(1);
+		}
+		catch(const BadScanParamException &e)
+		{
+		}
+
+		IndexPredicate query = { offsetof(tuple,d), DOUBLE, GT, 4500 };
+		checkPassFail(index.coversQuery(&query), true)
+		query.value = 3000;
+		checkPassFail((index.coversQuery(&query) || index.coversQuery(NULL)), false)
+
+		// relation writes only reach the index for records satisfying the predicate
+		{
+			Relation relation(file1, bufMgr);
+			relation.registerIndex(&index);
+			RecordId coldRid = relation.insertRecord(makeRecord(-500));
+			RecordId hotRid = relation.insertRecord(makeRecord(relationSize + 5000));
+			relation.updateRecord(coldRid, makeRecord(relationSize + 5001));
+			relation.updateRecord(hotRid, makeRecord(-501));
+			checkPassFail(intScan(&index, INT_MIN, GT, INT_MAX, LT, &hot), hotEntries + 1)
+			relation.deleteRecord(coldRid);
+			relation.deleteRecord(hotRid);
+			relation.flush();
+		}
+		checkPassFail(intScan(&index, INT_MIN, GT, INT_MAX, LT, &hot), hotEntries)
+
+		// a predicate on the key itself covers the ranges inside it
+		IndexPredicate lowKeys = { offsetof(tuple,i), INTEGER, LT, 1000 };
+		BTreeIndex keyIndex(relationName, keyPartialName, bufMgr, offsetof(tuple,i), INTEGER, false, false, false, &lowKeys);
+		int lowVal = 0, highVal = 1000;
+		checkPassFail(keyIndex.coversRange(&lowVal, GTE, &highVal, LT), true)
+		checkPassFail(keyIndex.coversRange(&lowVal, GTE, &highVal, LTE), false)
+		try
+		{
+			keyIndex.startScan(&lowVal, GTE, &highVal, LTE);
+			std::cout << "startScan of an uncovered range should throw" << std::endl;
+			exit(1);
+		}
+		catch(const BadScanParamException &e)
+		{
+		}
+		checkPassFail(intScan(&keyIndex, 0, GTE, 1000, LT), intScan(&fullIndex, 0, GTE, 1000, LT))
+	}
+
+	File::remove(partialName);
+	File::remove(keyPartialName);
+}
+
+// -----------------------------------------------------------------------------
+// intRidBitmapTests
+// -----------------------------------------------------------------------------
+
+void intRidBitmapTests()
+{
+  std::cout << "Combine the record ids of index ranges as bitmaps" << std::endl;
+	std::string partialName;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		IndexPredicate hot = { offsetof(tuple,d), DOUBLE, GTE, 2000 };
+		BTreeIndex hotIndex(relationName, partialName, bufMgr, offsetof(tuple,i), INTEGER, false, false, false, &hot);
+
+		// i < 3000 on one index and d >= 2000 on the other
+		int lowVal = 0, highVal = 3000, minKey = INT_MIN, maxKey = INT_MAX;
+		RidBitmap low = RidBitmap::fromScan(&index, &lowVal, GTE, &highVal, LT);
+		RidBitmap hotRids = RidBitmap::fromScan(&hotIndex, &minKey, GT, &maxKey, LT, &hot);
+		checkPassFail((low.getBitmapContainerCount() > 0), true)
+
+		RidBitmap both = low & hotRids;
+		checkPassFail(static_cast<int>(both.cardinality()), intScan(&index, 2000, GTE, 3000, LT))
+		RidBitmap either = low | hotRids;
+		checkPassFail(static_cast<int>(either.cardinality()), intScan(&index, 0, GTE, INT_MAX, LT))
+
+		// only the records of the intersection are fetched
+		BitmapHeapScan scan(file1, bufMgr, both);
+		int inRange = 0, fetched = 0;
+		try
+		{
+			RecordId rid;
+			while(1)
+			{
+				scan.scanNext(rid);
+				std::string recordStr = scan.getRecord();
+				RECORD record = *reinterpret_cast<const RECORD*>(recordStr.data());
+				if(record.i >= 2000 && record.i < 3000) inRange++;
+				fetched++;
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+		checkPassFail((inRange == fetched && fetched == static_cast<int>(both.cardinality())), true)
+	}
+	File::remove(partialName);
+}
+
+// -----------------------------------------------------------------------------
+// intMultiBuildTests
+// -----------------------------------------------------------------------------
+
+void intMultiBuildTests()
+{
+  std::cout << "Build several indexes with one scan of the relation" << std::endl;
+	int allEntries, hotEntries;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		allEntries = intScan(&index, INT_MIN, GT, INT_MAX, LT);
+		hotEntries = intScan(&index, 4000, GTE, INT_MAX, LT);
+	}
+	File::remove(intIndexName);
+
+	std::string indexName, partialName;
+	{
+		IndexPredicate hot = { offsetof(tuple,d), DOUBLE, GTE, 4000 };
+		BTreeIndex index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, true);
+		BTreeIndex hotIndex(relationName, partialName, bufMgr, offsetof(tuple,i), INTEGER, true, false, false, &hot);
+		std::vector<BTreeIndex*> indexes;
+		indexes.push_back(&index);
+		indexes.push_back(&hotIndex);
+		BTreeIndex::buildIndexes(indexes);
+
+		checkPassFail((index.isBuilding() || hotIndex.isBuilding()), false)
+		checkPassFail(intScan(&index, INT_MIN, GT, INT_MAX, LT), allEntries)
+		checkPassFail(intScan(&hotIndex, INT_MIN, GT, INT_MAX, LT, &hot), hotEntries)
+		checkPassFail(index.getIndexStats().numEntries, allEntries)
+		checkPassFail(index.leafFragmentation(), 0.0)
+	}
+
+	// the indexes are in sync with the relation, so they are opened without another scan
+	{
+		BTreeIndex index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, true);
+		checkPassFail(index.isBuilding(), false)
+		checkPassFail(intScan(&index, 4000, GTE, INT_MAX, LT), hotEntries)
+	}
+	File::remove(partialName);
+}
+
+// -----------------------------------------------------------------------------
+// intLimitTests
+// -----------------------------------------------------------------------------
+
+void intLimitTests()
+{
+  std::cout << "Scan the first K matching entries" << std::endl;
+	BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	int lowVal = 0, highVal = relationSize;
+
+	std::vector<RecordId> scanRids;
+	index.parallelScan(&lowVal, GTE, &highVal, LT, 1, scanRids);
+
+	// the limited scan returns the first 50 entries of the unlimited one, then completes
+	std::vector<RecordId> limitedRids;
+	index.startScan(&lowVal, GTE, &highVal, LT, 50);
+	try
+	{
+		RecordId rid;
+		while(1)
+		{
+			index.scanNext(rid);
+			limitedRids.push_back(rid);
+		}
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+	checkPassFail(limitedRids.size(), 50)
+	checkPassFail(std::equal(limitedRids.begin(), limitedRids.end(), scanRids.begin()), true)
+
+	// its leaf was released with the last entry, so a saved position has no leaf to resume from
+	ScanCursor cursor;
+	index.saveScan(cursor);
+	index.endScan();
+	checkPassFail(cursor.pageNo, Page::INVALID_NUMBER)
+	checkPassFail((cursor.lastRid == scanRids[49]), true)
+
+	// the limit spans all ranges of a multi-range scan, and counts the entries passing the key filter
+	int low1 = 100, high1 = 110, low2 = 500, high2 = 600, filterLow = 0, filterHigh = 550;
+	std::vector<ScanRange> ranges;
+	ScanRange first = { &low1, GTE, &high1, LT };
+	ScanRange second = { &low2, GTE, &high2, LT };
+	ranges.push_back(first);
+	ranges.push_back(second);
+	ScanRange filter = { &filterLow, GTE, &filterHigh, LT };
+	int expected = std::min(15, intMultiScan(&index, ranges, &filter));
+	index.startScan(ranges, &filter, 15);
+	int returned = 0;
+	try
+	{
+		RecordId rid;
+		while(1)
+		{
+			index.scanNext(rid);
+			returned++;
+		}
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+	index.endScan();
+	checkPassFail(returned, expected)
+
+	// a scan matching fewer entries than its limit returns all of them
+	lowVal = 25;
+	highVal = 40;
+	index.startScan(&lowVal, GT, &highVal, LT, 1000);
+	returned = 0;
+	try
+	{
+		RecordId rid;
+		while(1)
+		{
+			index.scanNext(rid);
+			returned++;
+		}
+	}
+	catch(const IndexScanCompletedException &e)
+	{
+	}
+	index.endScan();
+	checkPassFail(returned, intScan(&index, 25, GT, 40, LT))
+}
+
+std::streamoff indexFileSize(const std::string & fileName)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	return file.tellg();
+}
+
+int bitmapScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, std::size_t chunkSize)
+{
+	BitmapHeapScan scan(file1, bufMgr, index, &lowVal, lowOp, &highVal, highOp, chunkSize);
+	RecordId scanRid;
+	RecordId lastRid = { 0, 0, 0 };
+	int numResults = 0;
+	while(1)
+	{
+		try
+		{
+			scan.scanNext(scanRid);
+		}
+		catch(const EndOfFileException &e)
+		{
+			break;
+		}
+
+		// records of a chunk come in page order, and have to be in the range
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(scan.getRecord().data()));
+		bool inRange = (lowOp == GT ? myRec.i > lowVal : myRec.i >= lowVal) &&
+			(highOp == LT ? myRec.i < highVal : myRec.i <= highVal);
+		bool ordered = chunkSize != 0 || scanRid.page_number > lastRid.page_number ||
+			(scanRid.page_number == lastRid.page_number && scanRid.slot_number > lastRid.slot_number);
+		if(!inRange || !ordered) return -1;
+		lastRid = scanRid;
+		numResults++;
+	}
+
+  std::cout << "Number of results: " << numResults << " from " << scan.getPagesRead() << " pages" << std::endl;
+	return numResults;
+}
+
+int compositeScan(CompositeIndex *index, const CompositeKey& lowKey, Operator lowOp, const CompositeKey& highKey, Operator highOp)
+{
+	RecordId scanRid;
+	try
+	{
+		index->startScan(lowKey, lowOp, highKey, highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	int numResults = 0;
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
+		numResults++;
+	}
+	index->endScan();
+
+  std::cout << "Number of results: " << numResults << std::endl;
+	return numResults;
+}
+
+int snapshotScan(IndexSnapshot *snapshot, int lowVal, Operator lowOp, int highVal, Operator highOp)
+{
+	try
+	{
+		snapshot->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	// every entry has to lead back to a record within the range
+	int numResults = 0;
+	bool recordsMatch = true;
+	RecordId scanRid;
+	while(1)
+	{
+		try
+		{
+			snapshot->scanNext(scanRid);
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
+
+		Page *curPage;
+		bufMgr->readPage(file1, scanRid.page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+		bufMgr->unPinPage(file1, scanRid.page_number, false);
+		bool inRange = (lowOp == GT ? myRec.i > lowVal : myRec.i >= lowVal) && (highOp == LT ? myRec.i < highVal : myRec.i <= highVal);
+		recordsMatch = recordsMatch && inRange;
+		numResults++;
+	}
+	snapshot->endScan();
+	return recordsMatch ? numResults : -1;
+}
+
+int hashLookup(HashIndex *index, int key)
+{
+	std::vector<RecordId> rids;
+	try
+	{
+		index->lookup(&key, rids);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+    std::cout << "No Key Found for " << key << "." << std::endl;
+		return 0;
+	}
+
+	// entries of relation records have to lead back to a record with the key
+	for(std::size_t i = 0; key >= 0 && i < rids.size(); i++)
+	{
+		Page *curPage;
+		bufMgr->readPage(file1, rids[i].page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rids[i]).data()));
+		bufMgr->unPinPage(file1, rids[i].page_number, false);
+		if(myRec.i != key) return -1;
+	}
+	return static_cast<int>(rids.size());
+}
+
+std::string makeRecord(int key)
+{
+	sprintf(record1.s, "%05d string record", key);
+	record1.i = key;
+	record1.d = (double)key;
+	return std::string(reinterpret_cast<char*>(&record1), sizeof(record1));
+}
+
+int relationCount(int lowVal, int highVal)
+{
+	FileScan scan(relationName, bufMgr);
+	RecordId rid;
+	int numRecords = 0;
+	try
+	{
+		while(1)
+		{
+			scan.scanNext(rid);
+			int key = reinterpret_cast<const RECORD*>(scan.getRecord().data())->i;
+			if(key >= lowVal && key <= highVal) numRecords++;
+		}
+	}
+	catch(const EndOfFileException &e)
+	{
+	}
+	return numRecords;
 }
 
-int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, const IndexPredicate *queryPredicate)
 {
   RecordId scanRid;
 	Page *curPage;
@@ -389,7 +1745,7 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 	
 	try
 	{
-  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+  	index->startScan(&lowVal, lowOp, &highVal, highOp, 0, queryPredicate);
 	}
 	catch(const NoSuchKeyFoundException &e)
 	{
@@ -434,6 +1790,108 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 	return numResults;
 }
 
+int intMultiScan(BTreeIndex * index, const std::vector<ScanRange>& ranges, const ScanRange* keyFilter)
+{
+  RecordId scanRid;
+	Page *curPage;
+	int lastKey = 0;
+
+  std::cout << "Scan for " << ranges.size() << " ranges" << std::endl;
+
+  int numResults = 0;
+
+	try
+	{
+  	index->startScan(ranges, keyFilter);
+	}
+	catch(const NoSuchKeyFoundException &e)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	while(1)
+	{
+		try
+		{
+			index->scanNext(scanRid);
+			bufMgr->readPage(file1, scanRid.page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			bufMgr->unPinPage(file1, scanRid.page_number, false);
+
+			// entries of all ranges come back in key order
+			if( numResults > 0 && myRec.i <= lastKey )
+			{
+				std::cout << "Key " << myRec.i << " returned out of order" << std::endl;
+				exit(1);
+			}
+			lastKey = myRec.i;
+		}
+		catch(const IndexScanCompletedException &e)
+		{
+			break;
+		}
+
+		numResults++;
+	}
+
+  std::cout << "Number of results: " << numResults << std::endl;
+  index->endScan();
+  std::cout << std::endl;
+
+	return numResults;
+}
+
+// -----------------------------------------------------------------------------
+// extentTests
+// -----------------------------------------------------------------------------
+
+void extentTests()
+{
+  std::cout << "Allocate index file pages from extents" << std::endl;
+	std::string extentFileName = "relA.extents";
+	File::Extent saved;
+	{
+		BlobFile file = BlobFile::create(extentFileName);
+		PageId first, second, other;
+		file.allocatePage(first, 0);
+		file.allocatePage(second, 0);
+		file.allocatePage(other, 1);
+		checkPassFail(second, first + 1)
+		checkPassFail(other, first + BlobFile::EXTENT_PAGES)
+
+		// runs and new extents go after everything reserved so far
+		PageId run = file.reservePages(3);
+		checkPassFail(run, first + 2 * BlobFile::EXTENT_PAGES)
+
+		PageId last = second;
+		for(PageId i = 2; i < BlobFile::EXTENT_PAGES; i++)
+		{
+			file.allocatePage(last, 0);
+		}
+		checkPassFail(last, first + BlobFile::EXTENT_PAGES - 1)
+		file.allocatePage(last, 0);
+		checkPassFail(last, run + 3)
+		saved = file.getExtent(0);
+	}
+
+	// a restored extent goes on with the pages left in its run after the file was closed
+	{
+		BlobFile file = BlobFile::open(extentFileName);
+		file.restoreExtent(0, saved);
+		PageId next;
+		file.allocatePage(next, 0);
+		checkPassFail(next, saved.next)
+
+		// an extent that is already handing out pages keeps its run
+		File::Extent other = { 1, 2 };
+		file.restoreExtent(0, other);
+		file.allocatePage(next, 0);
+		checkPassFail(next, saved.next + 1)
+	}
+	File::remove(extentFileName);
+}
+
 // -----------------------------------------------------------------------------
 // errorTests
 // -----------------------------------------------------------------------------
@@ -548,6 +2006,22 @@ void errorTests()
 			std::cout << "BadScanrangeException Test 1 Passed." << std::endl;
 		}
 
+		std::cout << "Scan with overlapping ranges" << std::endl;
+		try
+		{
+			std::vector<ScanRange> ranges;
+			ScanRange range1 = { &int2, GTE, &int5, LTE };
+			ScanRange range2 = { &int5, GTE, &int5, LTE };
+			ranges.push_back(range1);
+			ranges.push_back(range2);
+			index.startScan(ranges);
+			std::cout << "BadScanrangeException Test 2 Failed." << std::endl;
+		}
+		catch(const BadScanrangeException &e)
+		{
+			std::cout << "BadScanrangeException Test 2 Passed." << std::endl;
+		}
+
 		deleteRelation();
 	}
 
@@ -0,0 +1,205 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "range_filter.h"
+#include <climits>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RANGEFILTER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace badgerdb
+{
+
+/**
+ * Turns a predicate into inclusive bounds. Returns false if no int satisfies it.
+ */
+static bool inclusiveBounds(int lowVal, Operator lowOp, int highVal, Operator highOp, int & low, int & high)
+{
+	low = lowVal;
+	high = highVal;
+	if(lowOp == Operator::GT) {
+		if(low == INT_MAX) return false;
+		low++;
+	}
+	if(highOp == Operator::LT) {
+		if(high == INT_MIN) return false;
+		high--;
+	}
+	return low <= high;
+}
+
+/**
+ * Selects the keys in [low, high]. Every position is written, and the count only moves past the selected ones.
+ */
+static int selectScalar(const int *keyArray, int count, int low, int high, int *selection)
+{
+	int selected = 0;
+	for(int i = 0; i < count; i++) {
+		selection[selected] = i;
+		selected += (keyArray[i] >= low) & (keyArray[i] <= high);
+	}
+	return selected;
+}
+
+/**
+ * Counts the keys in [low, high] without a branch per key.
+ */
+static int countScalar(const int *keyArray, int count, int low, int high)
+{
+	int counted = 0;
+	for(int i = 0; i < count; i++) {
+		counted += (keyArray[i] >= low) & (keyArray[i] <= high);
+	}
+	return counted;
+}
+
+#ifdef RANGEFILTER_AVX2
+
+/**
+ * Returns a bit for each of the eight keys at keyArray, set if the key is in [low, high].
+ */
+__attribute__((target("avx2")))
+static inline unsigned int compareEight(const int *keyArray, __m256i low, __m256i high)
+{
+	__m256i keys = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keyArray));
+	__m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(low, keys), _mm256_cmpgt_epi32(keys, high));
+	return ~static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 0xFFu;
+}
+
+/**
+ * For each 8 bit compare result, the lanes of its set bits packed to the front, one byte per lane.
+ */
+struct LaneTable {
+	std::uint64_t lanes[256];
+
+	LaneTable()
+	{
+		for(int bits = 0; bits < 256; bits++) {
+			lanes[bits] = 0;
+			int packed = 0;
+			for(int lane = 0; lane < 8; lane++) {
+				if(bits & (1 << lane)) {
+					lanes[bits] |= static_cast<std::uint64_t>(lane) << (8 * packed++);
+				}
+			}
+		}
+	}
+};
+
+static const LaneTable laneTable;
+
+__attribute__((target("avx2")))
+static int selectAvx2(const int *keyArray, int count, int low, int high, int *selection)
+{
+	__m256i lowVector = _mm256_set1_epi32(low);
+	__m256i highVector = _mm256_set1_epi32(high);
+	int selected = 0;
+	int i = 0;
+
+	// all eight positions are stored and the count moves past the selected ones; the store ends by i + 8 <= count
+	for(; i + 8 <= count; i += 8) {
+		unsigned int bits = compareEight(keyArray + i, lowVector, highVector);
+		__m256i lanes = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(laneTable.lanes[bits])));
+		__m256i positions = _mm256_add_epi32(lanes, _mm256_set1_epi32(i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(selection + selected), positions);
+		selected += __builtin_popcount(bits);
+	}
+
+	// the tail is shorter than a vector
+	int tail = selectScalar(keyArray + i, count - i, low, high, selection + selected);
+	for(int j = 0; j < tail; j++) {
+		selection[selected + j] += i;
+	}
+	return selected + tail;
+}
+
+__attribute__((target("avx2")))
+static void maskAvx2(const int *keyArray, int count, int low, int high, std::uint64_t *mask)
+{
+	__m256i lowVector = _mm256_set1_epi32(low);
+	__m256i highVector = _mm256_set1_epi32(high);
+	int i = 0;
+	for(; i + 8 <= count; i += 8) {
+		mask[i / 64] |= static_cast<std::uint64_t>(compareEight(keyArray + i, lowVector, highVector)) << (i % 64);
+	}
+	for(; i < count; i++) {
+		mask[i / 64] |= static_cast<std::uint64_t>((keyArray[i] >= low) & (keyArray[i] <= high)) << (i % 64);
+	}
+}
+
+__attribute__((target("avx2")))
+static int countAvx2(const int *keyArray, int count, int low, int high)
+{
+	__m256i lowVector = _mm256_set1_epi32(low);
+	__m256i highVector = _mm256_set1_epi32(high);
+	int counted = 0;
+	int i = 0;
+	for(; i + 8 <= count; i += 8) {
+		counted += __builtin_popcount(compareEight(keyArray + i, lowVector, highVector));
+	}
+	return counted + countScalar(keyArray + i, count - i, low, high);
+}
+
+#endif
+
+bool rangeFilterUsesAvx2()
+{
+#ifdef RANGEFILTER_AVX2
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+#else
+	return false;
+#endif
+}
+
+int selectKeyRange(const int *keyArray, int count, int lowVal, Operator lowOp, int highVal, Operator highOp, int *selection)
+{
+	int low, high;
+	if(!inclusiveBounds(lowVal, lowOp, highVal, highOp, low, high)) return 0;
+
+#ifdef RANGEFILTER_AVX2
+	if(rangeFilterUsesAvx2()) return selectAvx2(keyArray, count, low, high, selection);
+#endif
+	return selectScalar(keyArray, count, low, high, selection);
+}
+
+int countKeysBetween(const int *keyArray, int count, int low, int high)
+{
+#ifdef RANGEFILTER_AVX2
+	if(rangeFilterUsesAvx2()) return countAvx2(keyArray, count, low, high);
+#endif
+	return countScalar(keyArray, count, low, high);
+}
+
+int selectKeyRangeScalar(const int *keyArray, int count, int lowVal, Operator lowOp, int highVal, Operator highOp, int *selection)
+{
+	int low, high;
+	if(!inclusiveBounds(lowVal, lowOp, highVal, highOp, low, high)) return 0;
+	return selectScalar(keyArray, count, low, high, selection);
+}
+
+void maskKeyRange(const int *keyArray, int count, int lowVal, Operator lowOp, int highVal, Operator highOp, std::uint64_t *mask)
+{
+	memset(mask, 0, (count + 63) / 64 * sizeof(std::uint64_t));
+	int low, high;
+	if(!inclusiveBounds(lowVal, lowOp, highVal, highOp, low, high)) return;
+
+#ifdef RANGEFILTER_AVX2
+	if(rangeFilterUsesAvx2()) {
+		maskAvx2(keyArray, count, low, high, mask);
+		return;
+	}
+#endif
+	for(int i = 0; i < count; i++) {
+		mask[i / 64] |= static_cast<std::uint64_t>((keyArray[i] >= low) & (keyArray[i] <= high)) << (i % 64);
+	}
+}
+
+}
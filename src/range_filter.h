@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Selects the keys of a slice of a key array that satisfy a range predicate, and writes their positions
+ * in the slice to a selection vector, in order. Uses AVX2 when the CPU has it, a branch-free scalar loop otherwise.
+ *
+ * @param keyArray    First key of the slice.
+ * @param count       Number of keys in the slice.
+ * @param lowVal      Low value of the predicate.
+ * @param lowOp       Low operator (GT/GTE)
+ * @param highVal     High value of the predicate.
+ * @param highOp      High operator (LT/LTE)
+ * @param selection   Positions of the selected keys, returned in this. Must have room for count positions.
+ * @return Number of keys selected.
+ */
+int selectKeyRange(const int *keyArray, int count, int lowVal, Operator lowOp, int highVal, Operator highOp, int *selection);
+
+/**
+ * @brief Like selectKeyRange(), but sets bit i % 64 of mask[i / 64] for every selected position i instead.
+ *
+ * @param mask        Selection bitmask, returned in this. Must have room for (count + 63) / 64 words.
+ */
+void maskKeyRange(const int *keyArray, int count, int lowVal, Operator lowOp, int highVal, Operator highOp, std::uint64_t *mask);
+
+/**
+ * @brief Counts the keys of a slice of a key array in the inclusive range [low, high]. Uses AVX2 when the CPU has it,
+ * a branch-free scalar loop otherwise.
+ *
+ * @param keyArray    First key of the slice.
+ * @param count       Number of keys in the slice.
+ * @param low         Lowest key counted.
+ * @param high        Highest key counted.
+ * @return Number of keys in [low, high].
+ */
+int countKeysBetween(const int *keyArray, int count, int low, int high);
+
+/**
+ * @brief The scalar fallback of selectKeyRange(), for CPUs without AVX2 and for comparing with it.
+ */
+int selectKeyRangeScalar(const int *keyArray, int count, int lowVal, Operator lowOp, int highVal, Operator highOp, int *selection);
+
+/**
+ * @brief Returns true if the kernels use AVX2 on this CPU.
+ */
+bool rangeFilterUsesAvx2();
+
+}
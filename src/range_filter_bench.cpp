@@ -0,0 +1,110 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Micro-benchmark of the range filter kernels against the plain scalar loop, over leaf-sized key arrays
+ * at a range of selectivities. Built by "make bench", run as src/range_filter_bench.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "range_filter.h"
+
+using namespace badgerdb;
+
+const int LEAFCOUNT = 1024;
+const int ROUNDS = 50;
+const int KEYDOMAIN = 1000000;
+
+/**
+ * The loop a scan would otherwise run: one compare and branch per key.
+ */
+static int selectBranching(const int *keyArray, int count, int low, int high, int *selection)
+{
+	int selected = 0;
+	for(int i = 0; i < count; i++) {
+		if(keyArray[i] >= low && keyArray[i] <= high) {
+			selection[selected++] = i;
+		}
+	}
+	return selected;
+}
+
+/**
+ * Runs one kernel over every leaf ROUNDS times. Returns the nanoseconds per key; the number of keys selected
+ * in a round is returned in selected, to check the kernels against each other.
+ */
+template <class Kernel>
+static double timeKernel(const std::vector<int> & keys, Kernel kernel, long & selected)
+{
+	std::vector<int> selection(INTARRAYLEAFSIZE);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(int round = 0; round < ROUNDS; round++) {
+		selected = 0;
+		for(int leaf = 0; leaf < LEAFCOUNT; leaf++) {
+			selected += kernel(&keys[leaf * INTARRAYLEAFSIZE], &selection[0]);
+		}
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / (static_cast<double>(ROUNDS) * LEAFCOUNT * INTARRAYLEAFSIZE);
+}
+
+int main()
+{
+	// unsorted keys, as for a residual filter, so that the branching loop mispredicts at middling selectivity
+	std::vector<int> keys(LEAFCOUNT * INTARRAYLEAFSIZE);
+	srand(42);
+	for(std::size_t i = 0; i < keys.size(); i++) {
+		keys[i] = rand() % KEYDOMAIN;
+	}
+
+	std::cout << "range filter kernels, " << (rangeFilterUsesAvx2() ? "AVX2" : "scalar fallback")
+		<< ", ns per key" << std::endl;
+	std::cout << std::setw(12) << "selectivity" << std::setw(12) << "branching" << std::setw(12) << "scalar"
+		<< std::setw(12) << "select" << std::setw(12) << "mask" << std::endl;
+
+	const double selectivities[] = { 0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 1.0 };
+	for(std::size_t s = 0; s < sizeof(selectivities) / sizeof(selectivities[0]); s++) {
+		int low = 0;
+		int high = static_cast<int>(selectivities[s] * KEYDOMAIN) - 1;
+		long branchingCount, scalarCount, selectCount, maskCount;
+
+		double branching = timeKernel(keys, [=](const int *keyArray, int *selection) {
+			return selectBranching(keyArray, INTARRAYLEAFSIZE, low, high, selection);
+		}, branchingCount);
+		double scalar = timeKernel(keys, [=](const int *keyArray, int *selection) {
+			return selectKeyRangeScalar(keyArray, INTARRAYLEAFSIZE, low, GTE, high, LTE, selection);
+		}, scalarCount);
+		double select = timeKernel(keys, [=](const int *keyArray, int *selection) {
+			return selectKeyRange(keyArray, INTARRAYLEAFSIZE, low, GTE, high, LTE, selection);
+		}, selectCount);
+		double mask = timeKernel(keys, [=](const int *keyArray, int *selection) {
+			// the selection vector is big enough to hold the mask words
+			std::uint64_t *words = reinterpret_cast<std::uint64_t*>(selection);
+			maskKeyRange(keyArray, INTARRAYLEAFSIZE, low, GTE, high, LTE, words);
+			int count = 0;
+			for(int w = 0; w < (INTARRAYLEAFSIZE + 63) / 64; w++) {
+				for(std::uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+					count++;
+				}
+			}
+			return count;
+		}, maskCount);
+
+		std::cout << std::fixed << std::setprecision(3) << std::setw(12) << selectivities[s] << std::setw(12) << branching
+			<< std::setw(12) << scalar << std::setw(12) << select << std::setw(12) << mask;
+		if(scalarCount != branchingCount || selectCount != branchingCount || maskCount != branchingCount) {
+			std::cout << "  MISMATCH";
+		}
+		std::cout << std::endl;
+	}
+	return 0;
+}
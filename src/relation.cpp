@@ -0,0 +1,308 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "relation.h"
+#include "file_iterator.h"
+#include "exceptions/badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * Orders index updates by key. Used with a stable sort, so updates of the same key keep their order.
+ */
+static bool updateKeyLess(const IndexUpdate &u1, const IndexUpdate &u2)
+{
+  return u1.key < u2.key;
+}
+
+Relation::Relation(PageFile *relationFile, BufMgr *bufferMgr)
+{
+  file = relationFile;
+  bufMgr = bufferMgr;
+  deferred = false;
+
+  // inserts go to the last page of the file
+  lastPageNum = Page::INVALID_NUMBER;
+  for (FileIterator iter = file->begin(); iter != file->end(); ++iter)
+  {
+    lastPageNum = (*iter).page_number();
+  }
+}
+
+Relation::~Relation()
+{
+  try
+  {
+    flushIndexUpdates();
+  }
+  catch(const BadgerDbException &e)
+  {
+    // the destructor must not throw
+  }
+}
+
+void Relation::registerIndex(BTreeIndex *index)
+{
+  indexes.push_back(index);
+  pendingUpdates.push_back(std::vector<IndexUpdate>());
+  indexLive.push_back(true);
+}
+
+void Relation::startIndexBuild(BTreeIndex *index)
+{
+  if (!index->isBuilding())
+  {
+    registerIndex(index);
+    return;
+  }
+
+  // the build reads the relation from disk
+  flushIndexUpdates();
+  bufMgr->flushFile(file);
+
+  indexes.push_back(index);
+  pendingUpdates.push_back(std::vector<IndexUpdate>());
+  indexLive.push_back(false);
+}
+
+bool Relation::buildIndexStep(BTreeIndex *index, const int recordCount)
+{
+  for (std::size_t i = 0; i < indexes.size(); i++)
+  {
+    if (indexes[i] != index || indexLive[i])
+      continue;
+
+    if (!index->buildStep(recordCount))
+      return false;
+
+    applyIndexUpdates(i, true);
+    indexLive[i] = true;
+    return true;
+  }
+
+  return true;
+}
+
+void Relation::unregisterIndex(BTreeIndex *index)
+{
+  flushIndexUpdates();
+  for (std::size_t i = 0; i < indexes.size(); i++)
+  {
+    if (indexes[i] == index)
+    {
+      indexes.erase(indexes.begin() + i);
+      pendingUpdates.erase(pendingUpdates.begin() + i);
+      indexLive.erase(indexLive.begin() + i);
+      return;
+    }
+  }
+}
+
+RecordId Relation::insertRecord(const std::string &record)
+{
+  return insertRecords(std::vector<std::string>(1, record))[0];
+}
+
+std::vector<RecordId> Relation::insertRecords(const std::vector<std::string> &records)
+{
+  std::vector<RecordId> rids;
+  std::size_t next = 0;
+
+  while (next < records.size())
+  {
+    // fill the last page, or a new one once it is full
+    PageId pageNum;
+    Page *page;
+    bool newPage = lastPageNum == Page::INVALID_NUMBER;
+    if (newPage)
+    {
+      bufMgr->allocPage(file, pageNum, page);
+      lastPageNum = pageNum;
+    }
+    else
+    {
+      pageNum = lastPageNum;
+      bufMgr->readPage(file, pageNum, page);
+    }
+
+    std::size_t first = next;
+    while (next < records.size() && page->hasSpaceForRecord(records[next]))
+    {
+      RecordId rid = page->insertRecord(records[next]);
+      rids.push_back(rid);
+      addIndexUpdates(true, records[next], rid);
+      next++;
+    }
+
+    if (next > first)
+    {
+      bufMgr->unPinPage(file, pageNum, true);
+      pageWritten();
+    }
+    else if (newPage)
+    {
+      // the record does not even fit in an empty page; let the page report it
+      try
+      {
+        page->insertRecord(records[next]);
+      }
+      catch(...)
+      {
+        bufMgr->unPinPage(file, pageNum, true);
+        throw;
+      }
+    }
+    else
+    {
+      bufMgr->unPinPage(file, pageNum, false);
+      lastPageNum = Page::INVALID_NUMBER;
+    }
+  }
+
+  return rids;
+}
+
+void Relation::updateRecord(const RecordId &rid, const std::string &record)
+{
+  Page *page;
+  bufMgr->readPage(file, rid.page_number, page);
+
+  std::string oldRecord;
+  try
+  {
+    oldRecord = page->getRecord(rid);
+    page->updateRecord(rid, record);
+  }
+  catch(...)
+  {
+    bufMgr->unPinPage(file, rid.page_number, false);
+    throw;
+  }
+
+  // only a changed key moves the entry, or a record entering or leaving a partial index
+  for (std::size_t i = 0; i < indexes.size(); i++)
+  {
+    int offset = indexes[i]->getAttrByteOffset();
+    int oldKey = *reinterpret_cast<const int*>(oldRecord.data() + offset);
+    int newKey = *reinterpret_cast<const int*>(record.data() + offset);
+    bool oldCovered = indexes[i]->coversRecord(oldRecord.data());
+    bool newCovered = indexes[i]->coversRecord(record.data());
+    if (oldKey == newKey && oldCovered == newCovered)
+      continue;
+
+    if (oldCovered)
+    {
+      IndexUpdate removal = { false, oldKey, rid };
+      pendingUpdates[i].push_back(removal);
+    }
+    if (newCovered)
+    {
+      IndexUpdate addition = { true, newKey, rid };
+      pendingUpdates[i].push_back(addition);
+    }
+  }
+
+  bufMgr->unPinPage(file, rid.page_number, true);
+  pageWritten();
+}
+
+void Relation::deleteRecord(const RecordId &rid)
+{
+  Page *page;
+  bufMgr->readPage(file, rid.page_number, page);
+
+  std::string oldRecord;
+  try
+  {
+    oldRecord = page->getRecord(rid);
+    page->deleteRecord(rid);
+  }
+  catch(...)
+  {
+    bufMgr->unPinPage(file, rid.page_number, false);
+    throw;
+  }
+
+  addIndexUpdates(false, oldRecord, rid);
+  bufMgr->unPinPage(file, rid.page_number, true);
+  pageWritten();
+}
+
+void Relation::setDeferred(const bool deferIn)
+{
+  deferred = deferIn;
+  if (!deferred)
+  {
+    flushIndexUpdates();
+  }
+}
+
+void Relation::flushIndexUpdates()
+{
+  // the side log of an index being built waits for the build to finish
+  for (std::size_t i = 0; i < indexes.size(); i++)
+  {
+    if (indexLive[i])
+      applyIndexUpdates(i, false);
+  }
+}
+
+void Relation::flush()
+{
+  flushIndexUpdates();
+  bufMgr->flushFile(file);
+
+  for (std::size_t i = 0; i < indexes.size(); i++)
+  {
+    if (indexLive[i])
+      indexes[i]->syncRelationMarker();
+  }
+}
+
+void Relation::addIndexUpdates(const bool insert, const std::string &record, const RecordId &rid)
+{
+  for (std::size_t i = 0; i < indexes.size(); i++)
+  {
+    // a partial index only sees the records satisfying its predicate
+    if (!indexes[i]->coversRecord(record.data()))
+      continue;
+
+    IndexUpdate update = { insert, *reinterpret_cast<const int*>(record.data() + indexes[i]->getAttrByteOffset()), rid };
+    pendingUpdates[i].push_back(update);
+  }
+}
+
+void Relation::pageWritten()
+{
+  if (!deferred)
+  {
+    flushIndexUpdates();
+  }
+}
+
+void Relation::applyIndexUpdates(const std::size_t i, const bool catchUp)
+{
+  // sorted updates walk the leaves in order instead of jumping around the tree
+  std::vector<IndexUpdate> updates;
+  updates.swap(pendingUpdates[i]);
+  std::stable_sort(updates.begin(), updates.end(), updateKeyLess);
+
+  for (std::size_t j = 0; j < updates.size(); j++)
+  {
+    // the build may have read a page before or after the logged write to it
+    if (catchUp && indexes[i]->containsEntry(&updates[j].key, updates[j].rid) == updates[j].insert)
+      continue;
+
+    if (updates[j].insert)
+      indexes[i]->insertEntry(&updates[j].key, updates[j].rid);
+    else
+      indexes[i]->deleteEntry(&updates[j].key, updates[j].rid);
+  }
+}
+
+}
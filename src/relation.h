@@ -0,0 +1,224 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "btree.h"
+
+namespace badgerdb {
+
+/**
+ * @brief A change to an index caused by a write to a record of the relation.
+ */
+struct IndexUpdate
+{
+  /**
+   * True if the entry is inserted, false if it is deleted.
+   */
+  bool insert;
+
+  /**
+   * Key of the entry.
+   */
+  int key;
+
+  /**
+   * RecordId of the entry.
+   */
+  RecordId rid;
+};
+
+/**
+ * @brief This class is the write path of a relation. It inserts, updates and deletes records
+ * and keeps every BTreeIndex registered on the relation in sync with them.
+ *
+ * The index changes caused by the records of one heap page are collected while the page is
+ * pinned and applied as one batch, sorted by key, once the page has been unpinned dirty.
+ * In deferred mode the changes are held back until flushIndexUpdates() is called, and then
+ * applied in key order across all the pages written since.
+ *
+ * An index can also be built online, while the relation is written to. The build reads the
+ * relation in steps, and the index changes made in between are kept in a side log instead of
+ * being applied. Once the whole relation has been read the log is replayed, skipping changes
+ * the build already saw, and from then on the index is maintained like any other.
+ *
+ * While indexes are registered every write to the relation has to go through this class,
+ * otherwise the indexes go stale.
+ */
+class Relation
+{
+ public:
+
+  /**
+   * Constructs the write path for a relation.
+   *
+   * @param file      Relation file, shared with the caller so that both see the same buffer frames.
+   * @param bufMgr    Buffer Manager instance used to read/write pages into/from buffer pool.
+   */
+  Relation(PageFile *file, BufMgr *bufMgr);
+
+  /**
+   * Applies pending index updates. Does not close or flush the relation file, which belongs to the caller.
+   */
+  ~Relation();
+
+  /**
+   * Starts maintaining an index on this relation. The index must have been built from the relation.
+   *
+   * @param index   Index to maintain.
+   */
+  void registerIndex(BTreeIndex *index);
+
+  /**
+   * Stops maintaining an index, after applying its pending updates.
+   *
+   * @param index   Index to stop maintaining.
+   */
+  void unregisterIndex(BTreeIndex *index);
+
+  /**
+   * Starts maintaining an index constructed for an online build. The relation is flushed so
+   * the build sees every write made before it, and later writes go to the index's side log.
+   * An index that was opened rather than built is registered right away.
+   * Must be called before the first BTreeIndex::buildStep(). No page of the relation may be pinned.
+   *
+   * @param index   Index being built online.
+   */
+  void startIndexBuild(BTreeIndex *index);
+
+  /**
+   * Continues the online build of an index. Once the build has read the whole relation, its side
+   * log is replayed and the index is maintained on every write from then on.
+   *
+   * @param index       Index being built online, passed to startIndexBuild() before.
+   * @param recordCount Maximum number of records the build reads in this step.
+   * @return  True once the index is live.
+   */
+  bool buildIndexStep(BTreeIndex *index, const int recordCount);
+
+  /**
+   * Inserts a record into the last page of the relation, or into a new page if it is full.
+   *
+   * @param record  Bytes that compose the record.
+   * @return  ID of the newly inserted record.
+   * @throws  InsufficientSpaceException  If the record does not fit in an empty page.
+   */
+  RecordId insertRecord(const std::string &record);
+
+  /**
+   * Inserts records, filling each page before moving on to a new one. The index updates
+   * of each page are applied as one batch.
+   *
+   * @param records Records to insert.
+   * @return  IDs of the newly inserted records, in the same order.
+   * @throws  InsufficientSpaceException  If a record does not fit in an empty page.
+   */
+  std::vector<RecordId> insertRecords(const std::vector<std::string> &records);
+
+  /**
+   * Replaces the data of a record. Indexes are only touched if the record's key changed.
+   *
+   * @param rid     ID of the record to update.
+   * @param record  Updated bytes that compose the record.
+   * @throws  InvalidRecordException  If the record does not exist.
+   * @throws  InsufficientSpaceException  If the updated record does not fit in its page.
+   */
+  void updateRecord(const RecordId &rid, const std::string &record);
+
+  /**
+   * Deletes a record.
+   *
+   * @param rid     ID of the record to delete.
+   * @throws  InvalidRecordException  If the record does not exist.
+   */
+  void deleteRecord(const RecordId &rid);
+
+  /**
+   * Switches deferred index maintenance on or off. Switching it off applies the pending updates.
+   *
+   * @param deferred  True to hold index updates back until flushIndexUpdates().
+   */
+  void setDeferred(const bool deferred);
+
+  /**
+   * Returns true if index updates are deferred.
+   */
+  bool isDeferred() const { return deferred; }
+
+  /**
+   * Applies all pending index updates, in key order for every index.
+   */
+  void flushIndexUpdates();
+
+  /**
+   * Applies all pending index updates, writes the relation's dirty pages to disk and records
+   * in every registered index that it is in sync with the relation, so that it is reopened
+   * without a rebuild. No page of the relation may be pinned.
+   */
+  void flush();
+
+ private:
+
+  /**
+   * File of the relation.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read/write pages into/from buffer pool.
+   */
+  BufMgr        *bufMgr;
+
+  /**
+   * Indexes maintained on this relation.
+   */
+  std::vector<BTreeIndex*> indexes;
+
+  /**
+   * Updates not yet applied, one list per entry of indexes.
+   */
+  std::vector< std::vector<IndexUpdate> > pendingUpdates;
+
+  /**
+   * False for an entry of indexes whose online build hasn't caught up yet; its pending updates are its side log.
+   */
+  std::vector<bool> indexLive;
+
+  /**
+   * True if index updates are held back until flushIndexUpdates().
+   */
+  bool          deferred;
+
+  /**
+   * Last page of the relation, where inserts go.
+   */
+  PageId        lastPageNum;
+
+  /**
+   * Queues an index insert or delete for a record in every registered index.
+   */
+  void addIndexUpdates(const bool insert, const std::string &record, const RecordId &rid);
+
+  /**
+   * Called after a page has been unpinned dirty. Applies its index updates unless they are deferred.
+   */
+  void pageWritten();
+
+  /**
+   * Applies and clears the pending updates of indexes[i] in key order. When catching up after an
+   * online build, updates the build already saw are skipped.
+   */
+  void applyIndexUpdates(const std::size_t i, const bool catchUp);
+};
+
+}
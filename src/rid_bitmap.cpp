@@ -0,0 +1,378 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "rid_bitmap.h"
+#include <algorithm>
+#include <iterator>
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+
+namespace badgerdb {
+
+/**
+ * Returns the number of set bits of a word.
+ */
+static std::size_t bitCount(std::uint64_t bits)
+{
+  std::size_t count = 0;
+  while (bits != 0)
+  {
+    bits &= bits - 1;
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Appends the slots set in a bitmap to slots, in order.
+ */
+static void appendSlots(const std::vector<std::uint64_t> &words, std::vector<SlotId> &slots)
+{
+  for (std::size_t word = 0; word < words.size(); word++)
+  {
+    for (std::uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+    {
+      int bit = 0;
+      while (!(bits & (std::uint64_t(1) << bit)))
+      {
+        bit++;
+      }
+      slots.push_back(static_cast<SlotId>(word * 64 + bit));
+    }
+  }
+}
+
+RidBitmap::RidBitmap()
+{
+}
+
+RidBitmap RidBitmap::fromScan(BTreeIndex *index,
+                              const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+                              const IndexPredicate *queryPredicate)
+{
+  RidBitmap bitmap;
+  try
+  {
+    index->startScan(lowVal, lowOp, highVal, highOp, 0, queryPredicate);
+  }
+  catch(const NoSuchKeyFoundException &e)
+  {
+    return bitmap;
+  }
+
+  try
+  {
+    RecordId rid;
+    while (true)
+    {
+      index->scanNext(rid);
+      bitmap.add(rid);
+    }
+  }
+  catch(const IndexScanCompletedException &e)
+  {
+  }
+  index->endScan();
+  return bitmap;
+}
+
+void RidBitmap::add(const RecordId &rid)
+{
+  SlotContainer &container = containers[rid.page_number];
+  if (container.dense)
+  {
+    std::size_t word = rid.slot_number / 64;
+    if (container.words.size() <= word)
+    {
+      container.words.resize(word + 1, 0);
+    }
+    std::uint64_t bit = std::uint64_t(1) << (rid.slot_number % 64);
+    if (!(container.words[word] & bit))
+    {
+      container.words[word] |= bit;
+      container.count++;
+    }
+    return;
+  }
+
+  std::vector<SlotId>::iterator position =
+    std::lower_bound(container.slots.begin(), container.slots.end(), rid.slot_number);
+  if (position != container.slots.end() && *position == rid.slot_number)
+    return;
+  container.slots.insert(position, rid.slot_number);
+  container.count++;
+  compact(container);
+}
+
+bool RidBitmap::contains(const RecordId &rid) const
+{
+  std::map<PageId, SlotContainer>::const_iterator container = containers.find(rid.page_number);
+  return container != containers.end() && holds(container->second, rid.slot_number);
+}
+
+std::size_t RidBitmap::cardinality() const
+{
+  std::size_t count = 0;
+  for (std::map<PageId, SlotContainer>::const_iterator it = containers.begin(); it != containers.end(); ++it)
+  {
+    count += it->second.count;
+  }
+  return count;
+}
+
+std::size_t RidBitmap::getBitmapContainerCount() const
+{
+  std::size_t count = 0;
+  for (std::map<PageId, SlotContainer>::const_iterator it = containers.begin(); it != containers.end(); ++it)
+  {
+    if (it->second.dense)
+      count++;
+  }
+  return count;
+}
+
+RidBitmap RidBitmap::operator&(const RidBitmap &other) const
+{
+  // only pages both sets have can hold a record of the intersection
+  RidBitmap result;
+  std::map<PageId, SlotContainer>::const_iterator a = containers.begin();
+  std::map<PageId, SlotContainer>::const_iterator b = other.containers.begin();
+  while (a != containers.end() && b != other.containers.end())
+  {
+    if (a->first < b->first)
+    {
+      ++a;
+    }
+    else if (b->first < a->first)
+    {
+      ++b;
+    }
+    else
+    {
+      SlotContainer both = intersect(a->second, b->second);
+      if (both.count > 0)
+      {
+        result.containers.insert(result.containers.end(), std::make_pair(a->first, both));
+      }
+      ++a;
+      ++b;
+    }
+  }
+  return result;
+}
+
+RidBitmap RidBitmap::operator|(const RidBitmap &other) const
+{
+  RidBitmap result = *this;
+  result |= other;
+  return result;
+}
+
+RidBitmap &RidBitmap::operator&=(const RidBitmap &other)
+{
+  *this = *this & other;
+  return *this;
+}
+
+RidBitmap &RidBitmap::operator|=(const RidBitmap &other)
+{
+  for (std::map<PageId, SlotContainer>::const_iterator it = other.containers.begin(); it != other.containers.end(); ++it)
+  {
+    std::map<PageId, SlotContainer>::iterator mine = containers.find(it->first);
+    if (mine == containers.end())
+    {
+      containers.insert(std::make_pair(it->first, it->second));
+    }
+    else
+    {
+      mine->second = unite(mine->second, it->second);
+    }
+  }
+  return *this;
+}
+
+void RidBitmap::getRids(std::vector<RecordId> &rids) const
+{
+  rids.clear();
+  std::vector<SlotId> denseSlots;
+  for (std::map<PageId, SlotContainer>::const_iterator it = containers.begin(); it != containers.end(); ++it)
+  {
+    const std::vector<SlotId> *slots = &it->second.slots;
+    if (it->second.dense)
+    {
+      denseSlots.clear();
+      appendSlots(it->second.words, denseSlots);
+      slots = &denseSlots;
+    }
+
+    for (std::size_t i = 0; i < slots->size(); i++)
+    {
+      RecordId rid;
+      rid.page_number = it->first;
+      rid.slot_number = (*slots)[i];
+      rid.padding = 0;
+      rids.push_back(rid);
+    }
+  }
+}
+
+void RidBitmap::getSlotBitmaps(std::map< PageId, std::vector<std::uint64_t> > &pageBitmaps) const
+{
+  pageBitmaps.clear();
+  for (std::map<PageId, SlotContainer>::const_iterator it = containers.begin(); it != containers.end(); ++it)
+  {
+    std::vector<std::uint64_t> &words = pageBitmaps[it->first];
+    if (it->second.dense)
+    {
+      words = it->second.words;
+      continue;
+    }
+
+    const std::vector<SlotId> &slots = it->second.slots;
+    words.assign(slots.back() / 64 + 1, 0);
+    for (std::size_t i = 0; i < slots.size(); i++)
+    {
+      words[slots[i] / 64] |= std::uint64_t(1) << (slots[i] % 64);
+    }
+  }
+}
+
+RidBitmap::SlotContainer RidBitmap::intersect(const SlotContainer &a, const SlotContainer &b)
+{
+  SlotContainer result;
+
+  if (!a.dense && !b.dense)
+  {
+    std::set_intersection(a.slots.begin(), a.slots.end(), b.slots.begin(), b.slots.end(),
+                          std::back_inserter(result.slots));
+  }
+  else if (!a.dense || !b.dense)
+  {
+    // the slots of the array that the bitmap has
+    const SlotContainer &array = a.dense ? b : a;
+    const SlotContainer &bitmap = a.dense ? a : b;
+    for (std::size_t i = 0; i < array.slots.size(); i++)
+    {
+      if (holds(bitmap, array.slots[i]))
+        result.slots.push_back(array.slots[i]);
+    }
+  }
+  else
+  {
+    result.dense = true;
+    result.words.resize(std::min(a.words.size(), b.words.size()));
+    for (std::size_t word = 0; word < result.words.size(); word++)
+    {
+      result.words[word] = a.words[word] & b.words[word];
+    }
+  }
+
+  result.count = result.dense ? 0 : result.slots.size();
+  for (std::size_t word = 0; word < result.words.size(); word++)
+  {
+    result.count += bitCount(result.words[word]);
+  }
+  compact(result);
+  return result;
+}
+
+RidBitmap::SlotContainer RidBitmap::unite(const SlotContainer &a, const SlotContainer &b)
+{
+  SlotContainer result;
+
+  if (!a.dense && !b.dense)
+  {
+    std::set_union(a.slots.begin(), a.slots.end(), b.slots.begin(), b.slots.end(),
+                   std::back_inserter(result.slots));
+    result.count = result.slots.size();
+    compact(result);
+    return result;
+  }
+
+  // with a bitmap on either side the union is a bitmap
+  result.dense = true;
+  result.words.assign(std::max(a.dense ? a.words.size() : 0, b.dense ? b.words.size() : 0), 0);
+  const SlotContainer *sides[] = { &a, &b };
+  for (int side = 0; side < 2; side++)
+  {
+    const SlotContainer &container = *sides[side];
+    if (container.dense)
+    {
+      for (std::size_t word = 0; word < container.words.size(); word++)
+      {
+        result.words[word] |= container.words[word];
+      }
+      continue;
+    }
+
+    for (std::size_t i = 0; i < container.slots.size(); i++)
+    {
+      std::size_t word = container.slots[i] / 64;
+      if (result.words.size() <= word)
+      {
+        result.words.resize(word + 1, 0);
+      }
+      result.words[word] |= std::uint64_t(1) << (container.slots[i] % 64);
+    }
+  }
+
+  result.count = 0;
+  for (std::size_t word = 0; word < result.words.size(); word++)
+  {
+    result.count += bitCount(result.words[word]);
+  }
+  compact(result);
+  return result;
+}
+
+void RidBitmap::compact(SlotContainer &container)
+{
+  if (container.dense)
+  {
+    while (!container.words.empty() && container.words.back() == 0)
+    {
+      container.words.pop_back();
+    }
+
+    // an array takes two bytes a slot, a bitmap eight bytes per 64 slots up to the last one
+    if (container.count * sizeof(SlotId) < container.words.size() * sizeof(std::uint64_t))
+    {
+      container.slots.clear();
+      appendSlots(container.words, container.slots);
+      std::vector<std::uint64_t>().swap(container.words);
+      container.dense = false;
+    }
+    return;
+  }
+
+  if (container.slots.empty())
+    return;
+
+  std::size_t wordCount = container.slots.back() / 64 + 1;
+  if (container.count * sizeof(SlotId) > wordCount * sizeof(std::uint64_t))
+  {
+    container.words.assign(wordCount, 0);
+    for (std::size_t i = 0; i < container.slots.size(); i++)
+    {
+      container.words[container.slots[i] / 64] |= std::uint64_t(1) << (container.slots[i] % 64);
+    }
+    std::vector<SlotId>().swap(container.slots);
+    container.dense = true;
+  }
+}
+
+bool RidBitmap::holds(const SlotContainer &container, SlotId slot)
+{
+  if (container.dense)
+  {
+    std::size_t word = slot / 64;
+    return word < container.words.size() && (container.words[word] & (std::uint64_t(1) << (slot % 64)));
+  }
+  return std::binary_search(container.slots.begin(), container.slots.end(), slot);
+}
+
+}
@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstdint>
+#include "types.h"
+#include "btree.h"
+
+namespace badgerdb {
+
+/**
+ * @brief A compressed set of record ids, e.g. of the records matching one predicate.
+ *
+ * Like a roaring bitmap, the set is split by the high part of the record id, its page, and
+ * every page holding a record of the set has a container of slots. A container is a sorted
+ * array of slots while it holds few of them, and a bitmap of slots once that is smaller.
+ * AND and OR work container by container, so the record ids of pages that only one side
+ * has are never compared. Intersecting the bitmaps of two index ranges gives the records
+ * satisfying both predicates before any page of the relation is read.
+ */
+class RidBitmap
+{
+ public:
+
+  /**
+   * Creates an empty bitmap.
+   */
+  RidBitmap();
+
+  /**
+   * Builds the bitmap of the record ids in a range of an index. Starts and ends a scan of the index.
+   *
+   * @param index     Index to scan.
+   * @param lowVal    Low value of range, pointer to integer / double / char string
+   * @param lowOp     Low operator (GT/GTE)
+   * @param highVal   High value of range, pointer to integer / double / char string
+   * @param highOp    High operator (LT/LTE)
+   * @param queryPredicate  Predicate the records of the query satisfy, NULL if it has none
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  BadScanParamException If the index is partial and doesn't cover the scan
+   */
+  static RidBitmap fromScan(BTreeIndex *index,
+                            const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+                            const IndexPredicate *queryPredicate = NULL);
+
+  /**
+   * Adds a record id to the set.
+   */
+  void add(const RecordId &rid);
+
+  /**
+   * Returns true if the set holds a record id.
+   */
+  bool contains(const RecordId &rid) const;
+
+  /**
+   * Returns the number of record ids in the set.
+   */
+  std::size_t cardinality() const;
+
+  /**
+   * Returns the number of pages holding a record of the set.
+   */
+  std::size_t getPageCount() const { return containers.size(); }
+
+  /**
+   * Returns the number of pages whose container is a bitmap rather than an array.
+   */
+  std::size_t getBitmapContainerCount() const;
+
+  /**
+   * Returns the record ids held by both sets.
+   */
+  RidBitmap operator&(const RidBitmap &other) const;
+
+  /**
+   * Returns the record ids held by either set.
+   */
+  RidBitmap operator|(const RidBitmap &other) const;
+
+  /**
+   * Keeps only the record ids also held by other.
+   */
+  RidBitmap &operator&=(const RidBitmap &other);
+
+  /**
+   * Adds the record ids held by other.
+   */
+  RidBitmap &operator|=(const RidBitmap &other);
+
+  /**
+   * Returns the record ids of the set in page order, then slot order.
+   *
+   * @param rids  Record ids, returned in this.
+   */
+  void getRids(std::vector<RecordId> &rids) const;
+
+  /**
+   * Returns a bitmap of slots for every page of the set, in page order, with bit i % 64 of word i / 64 set for slot i.
+   *
+   * @param pageBitmaps Slot bitmaps, returned in this.
+   */
+  void getSlotBitmaps(std::map< PageId, std::vector<std::uint64_t> > &pageBitmaps) const;
+
+ private:
+
+  /**
+   * Slots of one page of the set: a sorted array of slots, or a bitmap of them if dense is true.
+   */
+  struct SlotContainer
+  {
+    SlotContainer() : dense(false), count(0) {}
+
+    bool dense;
+    std::size_t count;
+    std::vector<SlotId> slots;
+    std::vector<std::uint64_t> words;
+  };
+
+  /**
+   * Containers of the pages holding a record of the set, in page order. None of them is empty.
+   */
+  std::map<PageId, SlotContainer> containers;
+
+  /**
+   * Returns the slots held by both containers.
+   */
+  static SlotContainer intersect(const SlotContainer &a, const SlotContainer &b);
+
+  /**
+   * Returns the slots held by either container.
+   */
+  static SlotContainer unite(const SlotContainer &a, const SlotContainer &b);
+
+  /**
+   * Turns a container into an array or a bitmap, whichever is smaller.
+   */
+  static void compact(SlotContainer &container);
+
+  /**
+   * Returns true if a container holds a slot.
+   */
+  static bool holds(const SlotContainer &container, SlotId slot);
+};
+
+}